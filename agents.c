@@ -0,0 +1,187 @@
+/**
+ * @file agents.c
+ * @brief Implementation for structure-of-arrays agent state and batched move generation
+ */
+
+#include <semaphore.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "agents.h"
+
+/** Number of int elements in one aligned chunk */
+#define CHUNK_INTS (AGENTS_ALIGN / (int) sizeof(int))
+
+/** Number of arrays held in an agents_t */
+#define ARRAY_COUNT 7
+
+int agents_create(agents_t *agents, int count) {
+    memset(agents, 0, sizeof(*agents));
+    if (count < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int capacity = (count + CHUNK_INTS - 1) / CHUNK_INTS * CHUNK_INTS;
+    size_t array_size = (size_t) capacity * sizeof(int);
+
+    // aligned_alloc wants a non-zero multiple of the alignment
+    int *block = aligned_alloc(AGENTS_ALIGN, array_size > 0 ? ARRAY_COUNT * array_size : AGENTS_ALIGN);
+    if (!block)
+        return -1;
+    memset(block, 0, ARRAY_COUNT * array_size);
+
+    agents->count = count;
+    agents->capacity = capacity;
+    agents->block = block;
+    agents->x = block;
+    agents->y = block + capacity;
+    agents->action = (action_t *) (block + 2 * capacity);
+    agents->target = block + 3 * capacity;
+    agents->dir = block + 4 * capacity;
+    agents->dest_x = block + 5 * capacity;
+    agents->dest_y = block + 6 * capacity;
+
+    return 0;
+}
+
+void agents_destroy(agents_t *agents) {
+    free(agents->block);
+    memset(agents, 0, sizeof(*agents));
+}
+
+/**
+ * The vector paths below derive the deltas from comparisons against the direction indices,
+ * so they depend on this layout of MOVE_DELTA:
+ *   1 and 2 step the column by +1 and -1, 3 and 4 step the row by +1 and -1.
+ * Comparison masks are -1 when true, so mask(dir == 2) - mask(dir == 1) is +1 for direction 1 and -1 for 2.
+ */
+
+#if defined(__AVX2__)
+
+static int move_vector(const int *x, const int *y, const int *dir, int count, const int bounds[2],
+        int *new_x, int *new_y) {
+    const __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2), three = _mm256_set1_epi32(3);
+    const __m256i four = _mm256_set1_epi32(4), zero = _mm256_setzero_si256();
+    const __m256i max_x = _mm256_set1_epi32(bounds[0] - 1), max_y = _mm256_set1_epi32(bounds[1] - 1);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i d = _mm256_loadu_si256((const __m256i *) (dir + i));
+        __m256i dx = _mm256_sub_epi32(_mm256_cmpeq_epi32(d, four), _mm256_cmpeq_epi32(d, three));
+        __m256i dy = _mm256_sub_epi32(_mm256_cmpeq_epi32(d, two), _mm256_cmpeq_epi32(d, one));
+
+        __m256i nx = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *) (x + i)), dx);
+        __m256i ny = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *) (y + i)), dy);
+
+        // Reverse the direction if we go out of the bounds
+        nx = _mm256_add_epi32(nx, _mm256_and_si256(_mm256_cmpgt_epi32(zero, nx), two));
+        nx = _mm256_sub_epi32(nx, _mm256_and_si256(_mm256_cmpgt_epi32(nx, max_x), two));
+        ny = _mm256_add_epi32(ny, _mm256_and_si256(_mm256_cmpgt_epi32(zero, ny), two));
+        ny = _mm256_sub_epi32(ny, _mm256_and_si256(_mm256_cmpgt_epi32(ny, max_y), two));
+
+        _mm256_storeu_si256((__m256i *) (new_x + i), nx);
+        _mm256_storeu_si256((__m256i *) (new_y + i), ny);
+    }
+    return i;
+}
+
+#elif defined(__SSE2__)
+
+static int move_vector(const int *x, const int *y, const int *dir, int count, const int bounds[2],
+        int *new_x, int *new_y) {
+    const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2), three = _mm_set1_epi32(3);
+    const __m128i four = _mm_set1_epi32(4), zero = _mm_setzero_si128();
+    const __m128i max_x = _mm_set1_epi32(bounds[0] - 1), max_y = _mm_set1_epi32(bounds[1] - 1);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i *) (dir + i));
+        __m128i dx = _mm_sub_epi32(_mm_cmpeq_epi32(d, four), _mm_cmpeq_epi32(d, three));
+        __m128i dy = _mm_sub_epi32(_mm_cmpeq_epi32(d, two), _mm_cmpeq_epi32(d, one));
+
+        __m128i nx = _mm_add_epi32(_mm_loadu_si128((const __m128i *) (x + i)), dx);
+        __m128i ny = _mm_add_epi32(_mm_loadu_si128((const __m128i *) (y + i)), dy);
+
+        // Reverse the direction if we go out of the bounds
+        nx = _mm_add_epi32(nx, _mm_and_si128(_mm_cmplt_epi32(nx, zero), two));
+        nx = _mm_sub_epi32(nx, _mm_and_si128(_mm_cmpgt_epi32(nx, max_x), two));
+        ny = _mm_add_epi32(ny, _mm_and_si128(_mm_cmplt_epi32(ny, zero), two));
+        ny = _mm_sub_epi32(ny, _mm_and_si128(_mm_cmpgt_epi32(ny, max_y), two));
+
+        _mm_storeu_si128((__m128i *) (new_x + i), nx);
+        _mm_storeu_si128((__m128i *) (new_y + i), ny);
+    }
+    return i;
+}
+
+#else
+
+static int move_vector(const int *x, const int *y, const int *dir, int count, const int bounds[2],
+        int *new_x, int *new_y) {
+    return 0;
+}
+
+#endif
+
+void apply_move_batch(const int *x, const int *y, const int *dir, int count, const int bounds[2],
+        int *new_x, int *new_y) {
+    int i = move_vector(x, y, dir, count, bounds, new_x, new_y);
+
+    // Remaining elements use the same masks one at a time
+    for (; i < count; ++i) {
+        int nx = x[i] + (dir[i] == 3) - (dir[i] == 4);
+        int ny = y[i] + (dir[i] == 1) - (dir[i] == 2);
+
+        nx += 2 & -(nx < 0);
+        nx -= 2 & -(bounds[0] - 1 < nx);
+        ny += 2 & -(ny < 0);
+        ny -= 2 & -(bounds[1] - 1 < ny);
+
+        new_x[i] = nx;
+        new_y[i] = ny;
+    }
+}
+
+void agents_propose(agents_t *agents, const int bounds[2]) {
+    apply_move_batch(agents->x, agents->y, agents->dir, agents->count, bounds, agents->dest_x, agents->dest_y);
+}
+
+void agents_update_positions(agents_t *agents) {
+    const int *x = agents->x, *y = agents->y;
+    int *new_x = agents->dest_x, *new_y = agents->dest_y;
+    const action_t *action = agents->action;
+    int n = agents->count;
+
+    // Each pass sends at least one more loser back to its position, so n passes resolve every conflict
+    for (int k = 0; k < n; ++k) {
+        for (int i = 0; i < n; ++i) {
+            if (action[i] == ACT_DIE)
+                continue;
+
+            for (int j = i+1; j < n; ++j) {
+                if (action[j] == ACT_DIE || new_x[i] != new_x[j] || new_y[i] != new_y[j])
+                    continue;
+
+                bool i_stays = new_x[i] == x[i] && new_y[i] == y[i];
+                bool j_stays = new_x[j] == x[j] && new_y[j] == y[j];
+                int loser = !i_stays && j_stays ? i : j;
+                new_x[loser] = x[loser];
+                new_y[loser] = y[loser];
+            }
+        }
+    }
+
+    memcpy(agents->x, new_x, sizeof(int) * n);
+    memcpy(agents->y, new_y, sizeof(int) * n);
+}
@@ -0,0 +1,89 @@
+/**
+ * @file agents.h
+ * @brief Structure-of-arrays agent state and batched move generation
+ */
+
+#ifndef AGENTS_H_
+#define AGENTS_H_
+
+/** Alignment of every agent state array in bytes, enough for any vector width in use */
+#define AGENTS_ALIGN 64
+
+/**
+ * State of a population of agents stepped by a single thread
+ *
+ * Each field lives in its own AGENTS_ALIGN aligned array, padded to a whole number of vectors,
+ * so a step can load the same field for several agents at once.
+ */
+typedef struct {
+    int count;          ///< Number of agents
+    int capacity;       ///< Number of elements allocated per array, a multiple of AGENTS_ALIGN / sizeof(int)
+    int *x;             ///< Row of each agent
+    int *y;             ///< Column of each agent
+    action_t *action;   ///< Proposed action of each agent
+    int *target;        ///< Number of cells each agent aims to repair
+    int *dir;           ///< Index of the proposed direction of each agent in MOVE_DELTA
+    int *dest_x;        ///< Proposed destination row of each agent
+    int *dest_y;        ///< Proposed destination column of each agent
+    void *block;        ///< Allocation holding all of the arrays
+} agents_t;
+
+/**
+ * @brief Allocate state for a population of agents
+ *
+ * All arrays are zeroed, which puts every agent on (0,0) with ACT_MOVE and no target.
+ *
+ * @param[out] agents   Pointer to the agent state
+ * @param[in] count     Number of agents
+ *
+ * @retval 0        Allocation is successfully done
+ * @retval other    Some error occured. Sets errno to indicate error
+ */
+int agents_create(agents_t *agents, int count);
+
+/**
+ * @brief Free agent state allocated with agents_create
+ *
+ * @param[in] agents    Pointer to the agent state
+ */
+void agents_destroy(agents_t *agents);
+
+/**
+ * @brief Apply a directional move on a batch of positions
+ *
+ * Gives the same result as apply_move_bounded for every element, without branching on the
+ * direction or the bounds. Uses SSE2 or AVX2 when available.
+ *
+ * @param[in] x         Current row of each position
+ * @param[in] y         Current column of each position
+ * @param[in] dir       Index for direction of move in MOVE_DELTA array for each position
+ * @param[in] count     Number of positions
+ * @param[in] bounds    Number of rows and columns in the grid
+ * @param[out] new_x    Row of each position after the move
+ * @param[out] new_y    Column of each position after the move
+ */
+void apply_move_batch(const int *x, const int *y, const int *dir, int count, const int bounds[2],
+        int *new_x, int *new_y);
+
+/**
+ * @brief Propose the move of every agent from its current direction
+ *
+ * Fills dest_x and dest_y from x, y and dir with apply_move_batch.
+ *
+ * @param[in,out] agents    Pointer to the agent state
+ * @param[in] bounds        Number of rows and columns in the grid
+ */
+void agents_propose(agents_t *agents, const int bounds[2]);
+
+/**
+ * @brief Move every agent to its proposed destination, resolving conflicts
+ *
+ * Follows the same priority rules as update_positions: agents staying where they are win,
+ * then agents with lower indices win, and the losers stay where they are. Agents with
+ * ACT_DIE take no part in conflicts. dest_x and dest_y are left holding the new positions.
+ *
+ * @param[in,out] agents    Pointer to the agent state, with destinations filled in by agents_propose
+ */
+void agents_update_positions(agents_t *agents);
+
+#endif // AGENTS_H_
@@ -4,6 +4,7 @@
  */
 
 #include <semaphore.h>
+#include <stddef.h>
 #include "barrier.h"
 
 int barrier_init(barrier_t *barrier, int total) {
@@ -11,6 +12,8 @@ int barrier_init(barrier_t *barrier, int total) {
 
     barrier->total = total;
     barrier->ready = 0;
+    barrier->hook = NULL;
+    barrier->hook_arg = NULL;
 
     status = sem_init(&barrier->lock, 1, 1);
     if (status != 0)
@@ -23,6 +26,25 @@ int barrier_init(barrier_t *barrier, int total) {
     return 0;
 }
 
+void barrier_set_hook(barrier_t *barrier, barrier_hook_t hook, void *arg) {
+    barrier->hook = hook;
+    barrier->hook_arg = arg;
+}
+
+int barrier_reset(barrier_t *barrier, int total) {
+    int status = 0;
+
+    status = sem_wait(&barrier->lock);
+    if (status != 0)
+        return status;
+
+    barrier->total = total;
+    barrier->ready = 0;
+
+    sem_post(&barrier->lock);
+    return 0;
+}
+
 int barrier_cleanup(barrier_t *barrier) {
     int status = 0;
 
@@ -42,6 +64,8 @@ static int post_if_all_ready(barrier_t *barrier) {
 
     if (barrier->ready == barrier->total) {
         barrier->ready = 0;
+        if (barrier->hook && barrier->total > 0)
+            barrier->hook(barrier->hook_arg);
         for (int i = 0; i < barrier->total; ++i) {
             status = sem_post(&barrier->sync);
             if (status != 0)
@@ -84,3 +108,7 @@ int barrier_wait_for_all(barrier_t *barrier) {
     return sem_wait(&barrier->sync);
 }
 
+int barrier_try_wait(barrier_t *barrier) {
+    return sem_trywait(&barrier->sync);
+}
+
@@ -6,12 +6,17 @@
 #ifndef BARRIER_H
 #define BARRIER_H
 
+/** Function run by the last process to reach the barrier, before any process is released */
+typedef void (*barrier_hook_t)(void *arg);
+
 /** Synchronize access of multiple threads or processes at a single point of execution */
 typedef struct {
-    int total;      ///< Total number of processes
-    int ready;      ///< Number of processes ready to proceed
-    sem_t lock;     ///< Semaphore used for protecting read/write access to total and ready
-    sem_t sync;     ///< Semaphore used for waiting on barrier
+    int total;              ///< Total number of processes
+    int ready;              ///< Number of processes ready to proceed
+    sem_t lock;             ///< Semaphore used for protecting read/write access to total and ready
+    sem_t sync;             ///< Semaphore used for waiting on barrier
+    barrier_hook_t hook;    ///< Function run once all processes are ready, or NULL
+    void *hook_arg;         ///< Argument passed to hook
 } barrier_t;
 
 /**
@@ -24,6 +29,33 @@ typedef struct {
  */
 int barrier_init(barrier_t *barrier, int total);
 
+/**
+ * @brief Set a function to run each time all processes have reached the barrier
+ *
+ * The hook runs in the last process to signal ready or exit, while every other process is still
+ * blocked on the barrier, so it has exclusive access to anything the processes only touch between
+ * barriers. Processes sharing the barrier must have the hook at the same address, e.g. threads or
+ * children forked after the hook is set.
+ *
+ * @param[in] barrier   Pointer to barrier structure
+ * @param[in] hook      Function to run, or NULL to run nothing
+ * @param[in] arg       Argument passed to hook
+ */
+void barrier_set_hook(barrier_t *barrier, barrier_hook_t hook, void *arg);
+
+/**
+ * @brief Prepare a barrier for another run of processes without reinitializing its semaphores
+ *
+ * Must only be called once every process using the barrier has exited it, which leaves no
+ * process waiting and no pending posts. The hook is kept.
+ *
+ * @param[in] barrier   Pointer to barrier structure
+ * @param[in] total     Total number of processes that are going to use this barrier
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error
+ */
+int barrier_reset(barrier_t *barrier, int total);
+
 /**
  * @brief Cleanup barrier structure and free its resources
  *
@@ -60,4 +92,13 @@ int barrier_signal_exit(barrier_t *barrier);
  */
 int barrier_wait_for_all(barrier_t *barrier);
 
+/**
+ * @brief Pass the barrier only if all running processes have already signalled ready
+ *
+ * @param[in] barrier   Pointer to barrier structure
+ *
+ * @return 0 if the barrier was passed, otherwise returns non-zero and sets errno to EAGAIN if it would block
+ */
+int barrier_try_wait(barrier_t *barrier);
+
 #endif // BARRIER_H
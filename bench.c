@@ -0,0 +1,726 @@
+/**
+ * @file bench.c
+ * @brief Microbenchmarks for the simulation hot paths
+ *
+ * Every benchmark is run for a number of warmup repetitions that are discarded, then for a number
+ * of measured repetitions. Each result is printed as one JSON object per line with the mean,
+ * standard deviation and 95% confidence interval of the measured repetitions, along with the mean
+ * performance counters of a repetition. Counters are summed over the agents in benchmarks that run
+ * agents, and cover the whole repetition including its setup otherwise. Counters the kernel doesn't
+ * provide, e.g. hardware events inside a virtual machine, are null.
+ *
+ * Given a baseline recorded with the same seed, results are also compared against it and the run
+ * fails if steps/s dropped or LLC misses per step grew by more than the threshold.
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <semaphore.h>
+#include <pthread.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "agents.h"
+#include "kernels.h"
+#include "harness.h"
+#include "server.h"
+#include "coverage.h"
+#include "perf.h"
+
+/** Number of operations timed together in a single repetition of a microbenchmark */
+#define BATCH_SIZE 4096
+
+/** Number of barrier rounds timed in a single repetition */
+#define BARRIER_ROUNDS 1000
+
+/** Maximum number of measured repetitions */
+#define MAX_REPS 1000
+
+/** Maximum number of results read from a baseline */
+#define MAX_BASELINE 256
+
+/** Maximum length of a result line */
+#define LINE_MAX_LEN 1024
+
+/** A benchmark measuring one value per repetition for a given parameter */
+typedef struct {
+    const char *name;           ///< Name of the benchmark
+    const char *unit;           ///< Unit of the measured value
+    const char *const *params;  ///< NULL terminated list of parameters to run the benchmark with
+    double (*run)(const char *param, unsigned seed);    ///< Run one repetition and return the measured value
+} bench_t;
+
+/** Results are written here, since agents print to stdout */
+static FILE *out;
+
+/** Keeps the compiler from dropping the benchmarked work */
+static volatile int sink;
+
+/** Counters of the agents run by the current repetition */
+static perf_results_t *agent_perf;
+
+/** Agent steps done by the current repetition, 0 if it didn't run agents */
+static uint64_t rep_steps;
+
+/** A result read from a baseline */
+typedef struct {
+    char bench[64];             ///< Name of the benchmark
+    char param[64];             ///< Parameter it ran with
+    unsigned seed;              ///< Seed of the first measured repetition
+    double mean;                ///< Mean of the measured value
+    double misses_per_step;     ///< LLC misses per agent step, or NAN if not measured
+} baseline_t;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Two-sided 95% quantile of Student's t distribution for df = 1..30
+static double t_quantile(int df) {
+    static const double T95[30] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (df < 1)
+        return 0;
+    return df <= 30 ? T95[df - 1] : 1.960;
+}
+
+typedef struct {
+    barrier_t *barrier;     ///< Pair of barriers used on alternate rounds
+    int rounds;
+} barrier_args_t;
+
+// Rounds alternate between two barriers like the agents do, a single one can't be reused right away
+static void barrier_round(barrier_t barrier[2], int round) {
+    barrier_signal_ready(&barrier[round % 2]);
+    barrier_wait_for_all(&barrier[round % 2]);
+}
+
+static void *barrier_thread(void *data) {
+    barrier_args_t *args = data;
+    for (int i = 0; i < args->rounds; ++i)
+        barrier_round(args->barrier, i);
+    return NULL;
+}
+
+// Nanoseconds per barrier_signal_ready + barrier_wait_for_all round with the given number of participants
+static double bench_barrier(const char *param, unsigned seed) {
+    int participants = strtol(param, NULL, 0);
+    barrier_t barrier[2];
+    barrier_init(&barrier[0], participants);
+    barrier_init(&barrier[1], participants);
+
+    // One extra round lines everyone up before the clock starts
+    pthread_t threads[participants];
+    barrier_args_t args = {barrier, BARRIER_ROUNDS + 1};
+    for (int i = 1; i < participants; ++i)
+        pthread_create(&threads[i], NULL, barrier_thread, &args);
+
+    barrier_round(barrier, 0);
+
+    double start = now_ns();
+    for (int i = 1; i <= BARRIER_ROUNDS; ++i)
+        barrier_round(barrier, i);
+    double elapsed = now_ns() - start;
+
+    for (int i = 1; i < participants; ++i)
+        pthread_join(threads[i], NULL);
+    barrier_cleanup(&barrier[0]);
+    barrier_cleanup(&barrier[1]);
+
+    return elapsed / BARRIER_ROUNDS;
+}
+
+// Nanoseconds per update_positions call with agents packed into a square region of the given side
+static double bench_update_positions(const char *param, unsigned seed) {
+    int side = strtol(param, NULL, 0);
+    static int pos[BATCH_SIZE][AGENT_COUNT][2], dest[BATCH_SIZE][AGENT_COUNT][2], work[BATCH_SIZE][AGENT_COUNT][2];
+    action_t action[AGENT_COUNT];
+    for (int i = 0; i < AGENT_COUNT; ++i)
+        action[i] = ACT_MOVE;
+
+    // Distinct starting cells inside the region, smaller regions mean more conflicts
+    srand(seed);
+    for (int b = 0; b < BATCH_SIZE; ++b) {
+        for (int i = 0; i < AGENT_COUNT; ++i) {
+            bool duplicate;
+            do {
+                pos[b][i][0] = rand() % side;
+                pos[b][i][1] = rand() % side;
+                duplicate = false;
+                for (int j = 0; j < i; ++j)
+                    duplicate |= is_pos_equal(pos[b][i], pos[b][j]);
+            } while (duplicate);
+            apply_move(pos[b][i], rand() % DIRECTION_COUNT, dest[b][i]);
+        }
+    }
+    memcpy(work, pos, sizeof(work));
+
+    double start = now_ns();
+    for (int b = 0; b < BATCH_SIZE; ++b)
+        update_positions(work[b], action, dest[b]);
+    double elapsed = now_ns() - start;
+
+    sink = work[BATCH_SIZE - 1][0][0];
+    return elapsed / BATCH_SIZE;
+}
+
+// Nanoseconds per apply_move call
+static double bench_apply_move(const char *param, unsigned seed) {
+    static int pos[BATCH_SIZE][2], dir[BATCH_SIZE], new_pos[BATCH_SIZE][2];
+
+    srand(seed);
+    for (int b = 0; b < BATCH_SIZE; ++b) {
+        pos[b][0] = rand() % GRID_SIZE;
+        pos[b][1] = rand() % GRID_SIZE;
+        dir[b] = rand() % DIRECTION_COUNT;
+    }
+
+    double start = now_ns();
+    for (int b = 0; b < BATCH_SIZE; ++b)
+        apply_move(pos[b], dir[b], new_pos[b]);
+    double elapsed = now_ns() - start;
+
+    sink = new_pos[BATCH_SIZE - 1][0];
+    return elapsed / BATCH_SIZE;
+}
+
+// Nanoseconds to propose one move for every agent of a population of the given size
+static double bench_propose(const char *param, unsigned seed) {
+    bool batched = strncmp(param, "batch", strlen("batch")) == 0;
+    int count = strtol(strchr(param, '/') + 1, NULL, 0);
+    const int bounds[2] = {GRID_SIZE, GRID_SIZE};
+
+    agents_t agents;
+    if (agents_create(&agents, count) != 0)
+        return NAN;
+
+    srand(seed);
+    for (int k = 0; k < count; ++k) {
+        agents.x[k] = rand() % GRID_SIZE;
+        agents.y[k] = rand() % GRID_SIZE;
+        agents.dir[k] = rand() % DIRECTION_COUNT;
+    }
+
+    const int calls = 16;
+    double start = now_ns();
+    for (int i = 0; i < calls; ++i) {
+        if (batched) {
+            agents_propose(&agents, bounds);
+        }
+        else {
+            for (int k = 0; k < count; ++k) {
+                int pos[2] = {agents.x[k], agents.y[k]}, dest[2];
+                apply_move_bounded(pos, agents.dir[k], bounds, dest);
+                agents.dest_x[k] = dest[0];
+                agents.dest_y[k] = dest[1];
+            }
+        }
+    }
+    double elapsed = now_ns() - start;
+
+    sink = agents.dest_x[count - 1];
+    agents_destroy(&agents);
+    return elapsed / calls;
+}
+
+// Nanoseconds per step of every agent through a kernel, param is "<generic|specialized>/<agents>x<grid size>"
+static double bench_kernel_step(const char *param, unsigned seed) {
+    enum { MAX_AGENTS = 64 };
+    int agents, size;
+    sscanf(strchr(param, '/') + 1, "%dx%d", &agents, &size);
+    const int bounds[2] = {size, size};
+    const kernel_t *kernel = strncmp(param, "generic", strlen("generic")) == 0 ?
+        kernel_generic() : kernel_select(agents, bounds);
+
+    static int pos[BATCH_SIZE / 16][MAX_AGENTS][2], dir[BATCH_SIZE / 16][MAX_AGENTS], log[MAX_AGENTS];
+    int fixed[MAX_AGENTS] = {0}, dest[MAX_AGENTS][2];
+    action_t action[MAX_AGENTS];
+
+    srand(seed);
+    for (int b = 0; b < BATCH_SIZE / 16; ++b) {
+        for (int i = 0; i < agents; ++i) {
+            pos[b][i][0] = rand() % size;
+            pos[b][i][1] = rand() % size;
+            dir[b][i] = rand() % DIRECTION_COUNT;
+        }
+    }
+    for (int i = 0; i < agents; ++i) {
+        log[i] = rand() % 8;
+        action[i] = ACT_MOVE;
+    }
+
+    int exits = 0;
+    double start = now_ns();
+    for (int b = 0; b < BATCH_SIZE / 16; ++b) {
+        for (int i = 0; i < agents; ++i) {
+            kernel->merge_log(fixed, log, agents);
+            exits += kernel->should_exit(fixed, agents, i, INT_MAX, INT_MAX);
+            kernel->apply_move(pos[b][i], dir[b][i], bounds, dest[i]);
+        }
+        kernel->update_positions(pos[b], action, dest, agents);
+    }
+    double elapsed = now_ns() - start;
+
+    sink = exits + pos[0][0][0];
+    return elapsed / (BATCH_SIZE / 16);
+}
+
+// Nanoseconds per initialize_shared_mem + cleanup_shared_mem
+static double bench_grid_init(const char *param, unsigned seed) {
+    static shared_mem_t mem;
+    const int calls = 64;
+
+    srand(seed);
+    double start = now_ns();
+    for (int i = 0; i < calls; ++i) {
+        initialize_shared_mem(&mem);
+        cleanup_shared_mem(&mem);
+    }
+    double elapsed = now_ns() - start;
+
+    sink = mem.total_broken;
+    return elapsed / calls;
+}
+
+// Agent steps per second of a whole unpaced run, param is "<lockstep|relaxedK>/<process|thread>"
+static double bench_end_to_end(const char *param, unsigned seed) {
+    srand(seed);
+    shared_mem_t *mem = harness_map();
+    if (!mem)
+        return NAN;
+
+    mem->perf = agent_perf;
+    if (strncmp(param, "relaxed", strlen("relaxed")) == 0) {
+        mem->mode = MODE_RELAXED;
+        mem->max_staleness = strtol(param + strlen("relaxed"), NULL, 0);
+    }
+    bool use_threads = strstr(param, "/thread") != NULL;
+
+    // Nobody reaches their target, so the run ends once the whole grid is fixed
+    fflush(stdout);
+    double start = now_ns();
+    if (use_threads) {
+        harness_run(mem, HARNESS_NO_TARGET);
+    }
+    else {
+        for (int i = 0; i < AGENT_COUNT; ++i) {
+            if (fork() == 0) {
+                agent(mem, i, HARNESS_NO_TARGET);
+                fflush(stdout);
+                _exit(0);
+            }
+        }
+        for (int i = 0; i < AGENT_COUNT; ++i)
+            wait(NULL);
+    }
+    double elapsed = now_ns() - start;
+
+    int steps = 0;
+    for (int i = 0; i < AGENT_COUNT; ++i)
+        steps += mem->result[i].steps;
+    rep_steps = steps;
+
+    harness_unmap(mem);
+
+    return steps / (elapsed / 1e9);
+}
+
+/** Resident server used by the pooled startup benchmark, created on first use */
+static server_t pool;
+static bool pool_ready = false;
+
+/** Parameters of a run that ends as soon as every agent has made a single repair */
+static const server_request_t SHORT_RUN = {
+    .target = {1, 1, 1, 1},
+    .seed = 0,
+    .mode = MODE_RELAXED,
+    .max_staleness = 4,
+    .pacing_us = 0
+};
+
+// Wall time of a whole short run, param "cold" sets up and tears down a named mapping like ./repairmen does
+// and "pooled" hands the run to a resident server
+static double bench_run_latency(const char *param, unsigned seed) {
+    server_request_t request = SHORT_RUN;
+    request.seed = seed + 1;
+
+    if (strcmp(param, "pooled") == 0) {
+        if (!pool_ready) {
+            if (server_create(&pool, &SHORT_RUN) != 0)
+                return NAN;
+            pool_ready = true;
+        }
+
+        // Each repetition asks for its own seed, so the time includes resetting the slot for it
+        server_reply_t reply;
+        double start = now_ns();
+        if (server_run(&pool, &request, &reply) != 0)
+            return NAN;
+        return (now_ns() - start) / 1e3;
+    }
+
+    fflush(stdout);
+    double start = now_ns();
+
+    int fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd == -1 || ftruncate(fd, sizeof(shared_mem_t)) == -1)
+        return NAN;
+    shared_mem_t *mem = mmap(NULL, sizeof(shared_mem_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+        return NAN;
+
+    srand(request.seed);
+    initialize_shared_mem(mem);
+    mem->mode = request.mode;
+    mem->max_staleness = request.max_staleness;
+    mem->pacing_us = request.pacing_us;
+
+    for (int i = 0; i < AGENT_COUNT; ++i) {
+        if (fork() == 0) {
+            agent(mem, i, request.target[i]);
+            fflush(stdout);
+            _exit(0);
+        }
+    }
+    for (int i = 0; i < AGENT_COUNT; ++i)
+        wait(NULL);
+
+    cleanup_shared_mem(mem);
+    munmap(mem, sizeof(shared_mem_t));
+    shm_unlink(SHM_NAME);
+
+    return (now_ns() - start) / 1e3;
+}
+
+// Agent steps needed to fix the whole grid in lockstep, param is "random" or "map" for moves guided by the coverage map
+static double bench_steps_to_clear(const char *param, unsigned seed) {
+    srand(seed);
+    shared_mem_t *mem = harness_map();
+    if (!mem)
+        return NAN;
+
+    mem->perf = agent_perf;
+    if (strcmp(param, "map") == 0 && !(mem->coverage = coverage_create(mem->bounds))) {
+        harness_unmap(mem);
+        return NAN;
+    }
+
+    harness_run(mem, HARNESS_NO_TARGET);
+
+    int steps = 0;
+    for (int i = 0; i < AGENT_COUNT; ++i)
+        steps += mem->result[i].steps;
+    rep_steps = steps;
+
+    if (mem->coverage)
+        coverage_destroy(mem->coverage);
+    harness_unmap(mem);
+
+    return steps;
+}
+
+static const char *const BARRIER_PARAMS[] = {"1", "2", "4", "8", NULL};
+static const char *const DENSITY_PARAMS[] = {"2", "3", "4", "7", NULL};
+static const char *const NO_PARAMS[] = {"", NULL};
+static const char *const KERNEL_PARAMS[] = {
+    "generic/4x8", "specialized/4x8", "generic/4x64", "specialized/4x64", "generic/4x1024", "specialized/4x1024", NULL
+};
+static const char *const PROPOSE_PARAMS[] = {"scalar/10000", "batch/10000", NULL};
+static const char *const MOVE_PARAMS[] = {"random", "map", NULL};
+static const char *const STARTUP_PARAMS[] = {"cold", "pooled", NULL};
+static const char *const ENGINE_PARAMS[] = {
+    "lockstep/process", "lockstep/thread", "relaxed0/thread", "relaxed4/thread", "relaxed4/process", NULL
+};
+
+static const bench_t BENCHMARKS[] = {
+    {"barrier_round_trip", "ns/round", BARRIER_PARAMS, bench_barrier},
+    {"update_positions", "ns/call", DENSITY_PARAMS, bench_update_positions},
+    {"apply_move", "ns/call", NO_PARAMS, bench_apply_move},
+    {"propose", "ns/step", PROPOSE_PARAMS, bench_propose},
+    {"kernel_step", "ns/step", KERNEL_PARAMS, bench_kernel_step},
+    {"grid_init", "ns/call", NO_PARAMS, bench_grid_init},
+    {"end_to_end", "steps/s", ENGINE_PARAMS, bench_end_to_end},
+    {"steps_to_clear", "steps/run", MOVE_PARAMS, bench_steps_to_clear},
+    {"run_latency", "us/run", STARTUP_PARAMS, bench_run_latency},
+};
+
+// Run one measured repetition, counters are those of the agents if it ran any or of the whole process otherwise
+static double measure(const bench_t *bench, const char *param, unsigned seed, uint64_t values[PERF_COUNTER_COUNT]) {
+    perf_counters_t counters;
+    perf_results_reset(agent_perf);
+    rep_steps = 0;
+
+    perf_open(&counters, true);
+    double sample = bench->run(param, seed);
+    perf_read(&counters, values);
+    perf_close(&counters);
+
+    if (rep_steps == 0) {
+        // Only agents count their blocked waits
+        values[PERF_FUTEX_WAITS] = PERF_UNAVAILABLE;
+        return sample;
+    }
+
+    for (int c = 0; c < PERF_COUNTER_COUNT; ++c) {
+        values[c] = 0;
+        for (int i = 0; i < AGENT_COUNT && values[c] != PERF_UNAVAILABLE; ++i)
+            values[c] = agent_perf->agent[i][c] == PERF_UNAVAILABLE ? PERF_UNAVAILABLE : values[c] + agent_perf->agent[i][c];
+    }
+    return sample;
+}
+
+// Print a value as a JSON number, or null if it wasn't measured
+static void print_number(const char *key, double value) {
+    if (isnan(value))
+        fprintf(out, ",\"%s\":null", key);
+    else
+        fprintf(out, ",\"%s\":%.3f", key, value);
+}
+
+static double samples_mean(const double samples[], int reps) {
+    double mean = 0;
+    for (int i = 0; i < reps; ++i)
+        mean += samples[i];
+    return mean / reps;
+}
+
+static void report(const bench_t *bench, const char *param, unsigned seed, int warmup, double samples[], int reps,
+        const double counters[PERF_COUNTER_COUNT], double misses_per_step) {
+    double mean = samples_mean(samples, reps), var = 0, min = samples[0], max = samples[0];
+    for (int i = 0; i < reps; ++i) {
+        min = fmin(min, samples[i]);
+        max = fmax(max, samples[i]);
+    }
+
+    for (int i = 0; i < reps; ++i)
+        var += (samples[i] - mean) * (samples[i] - mean);
+    double stddev = reps > 1 ? sqrt(var / (reps - 1)) : 0;
+    double half = t_quantile(reps - 1) * stddev / sqrt(reps);
+
+    fprintf(out, "{\"bench\":\"%s\",\"param\":\"%s\",\"unit\":\"%s\",\"seed\":%u,\"warmup\":%d,\"reps\":%d,"
+            "\"mean\":%.3f,\"stddev\":%.3f,\"ci95_low\":%.3f,\"ci95_high\":%.3f,\"min\":%.3f,\"max\":%.3f",
+            bench->name, param, bench->unit, seed, warmup, reps,
+            mean, stddev, mean - half, mean + half, min, max);
+    for (int c = 0; c < PERF_COUNTER_COUNT; ++c)
+        print_number(PERF_COUNTER_NAMES[c], counters[c]);
+    print_number("llc_misses_per_step", misses_per_step);
+    fprintf(out, "}\n");
+    fflush(out);
+}
+
+// Find a field in a result line and return a pointer to its value, or NULL if missing
+static const char *json_field(const char *line, const char *key) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *field = strstr(line, pattern);
+    return field ? field + strlen(pattern) : NULL;
+}
+
+// Copy a string field of a result line, false if missing
+static bool json_string(const char *line, const char *key, char *value, size_t size) {
+    const char *field = json_field(line, key);
+    if (!field || *field != '"')
+        return false;
+
+    const char *end = strchr(field + 1, '"');
+    if (!end || (size_t) (end - field - 1) >= size)
+        return false;
+    memcpy(value, field + 1, end - field - 1);
+    value[end - field - 1] = '\0';
+    return true;
+}
+
+// Value of a number field of a result line, NAN if missing or null
+static double json_number(const char *line, const char *key) {
+    const char *field = json_field(line, key);
+    if (!field || strncmp(field, "null", strlen("null")) == 0)
+        return NAN;
+    return strtod(field, NULL);
+}
+
+/**
+ * Read the results of an earlier run
+ *
+ * Returns the number of results read, or -1 if the file can't be read
+ */
+static int load_baseline(const char *path, baseline_t baseline[], int size) {
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return -1;
+
+    int count = 0;
+    char line[LINE_MAX_LEN];
+    while (count < size && fgets(line, sizeof(line), file)) {
+        baseline_t *entry = &baseline[count];
+        if (!json_string(line, "bench", entry->bench, sizeof(entry->bench)) ||
+                !json_string(line, "param", entry->param, sizeof(entry->param)))
+            continue;
+
+        // Converting NaN or an out of range number to unsigned is undefined, so such lines are skipped
+        double seed = json_number(line, "seed");
+        entry->mean = json_number(line, "mean");
+        if (isnan(seed) || seed < 0 || seed > UINT_MAX || isnan(entry->mean))
+            continue;
+
+        entry->seed = seed;
+        entry->misses_per_step = json_number(line, "llc_misses_per_step");
+        count ++;
+    }
+
+    fclose(file);
+    return count;
+}
+
+/**
+ * Compare a result against the baseline, and print what regressed beyond threshold percent
+ *
+ * Returns true if the result regressed
+ */
+static bool check_regression(const baseline_t baseline[], int count, double threshold,
+        const bench_t *bench, const char *param, unsigned seed, double mean, double misses_per_step) {
+    const baseline_t *entry = NULL;
+    for (int i = 0; i < count && !entry; ++i)
+        if (strcmp(baseline[i].bench, bench->name) == 0 && strcmp(baseline[i].param, param) == 0)
+            entry = &baseline[i];
+
+    if (!entry) {
+        fprintf(stderr, "Note: %s %s is not in the baseline\n", bench->name, param);
+        return false;
+    }
+
+    // Other seeds run a different simulation, so their numbers can't be compared
+    if (entry->seed != seed) {
+        fprintf(stderr, "Regression: %s %s baseline was recorded with seed %u, not %u\n",
+                bench->name, param, entry->seed, seed);
+        return true;
+    }
+
+    bool regressed = false;
+    if (strcmp(bench->unit, "steps/s") == 0 && mean < entry->mean * (1 - threshold / 100)) {
+        fprintf(stderr, "Regression: %s %s steps/s %.3f -> %.3f (%+.1f%%)\n",
+                bench->name, param, entry->mean, mean, (mean / entry->mean - 1) * 100);
+        regressed = true;
+    }
+
+    // Misses are skipped where either run couldn't count them
+    if (!isnan(misses_per_step) && !isnan(entry->misses_per_step) &&
+            misses_per_step > entry->misses_per_step * (1 + threshold / 100)) {
+        fprintf(stderr, "Regression: %s %s llc_misses_per_step %.3f -> %.3f (%+.1f%%)\n",
+                bench->name, param, entry->misses_per_step, misses_per_step,
+                (misses_per_step / entry->misses_per_step - 1) * 100);
+        regressed = true;
+    }
+
+    return regressed;
+}
+
+static void print_usage(void) {
+    fprintf(stderr, "Usage: ./bench_repairmen [-w warmup] [-r reps] [-s seed] [-b name] [-B baseline] [-t threshold]\n");
+}
+
+int main(int argc, char *argv[]) {
+    int warmup = 3, reps = 10;
+    unsigned seed = 1;
+    const char *filter = NULL, *baseline_path = NULL;
+    double threshold = 10;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "w:r:s:b:B:t:")) != -1) {
+        switch (opt) {
+            case 'w': warmup = strtol(optarg, NULL, 0); break;
+            case 'r': reps = strtol(optarg, NULL, 0); break;
+            case 's': seed = strtoul(optarg, NULL, 0); break;
+            case 'b': filter = optarg; break;
+            case 'B': baseline_path = optarg; break;
+            case 't': threshold = strtod(optarg, NULL); break;
+            default:
+                print_usage();
+                return -1;
+        }
+    }
+
+    if (warmup < 0 || reps < 1 || MAX_REPS < reps || threshold < 0) {
+        print_usage();
+        return -1;
+    }
+
+    static baseline_t baseline[MAX_BASELINE];
+    int baseline_count = 0;
+    if (baseline_path && (baseline_count = load_baseline(baseline_path, baseline, MAX_BASELINE)) == -1) {
+        perror("Error: Can't read baseline");
+        return -1;
+    }
+
+    agent_perf = perf_results_create();
+    if (!agent_perf) {
+        perror("Error: Can't create performance counters");
+        return -1;
+    }
+
+    // Keep results on stdout and send the agents' exit messages elsewhere
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    int devnull = open("/dev/null", O_WRONLY);
+    if (!out || devnull == -1) {
+        fprintf(stderr, "Error: Can't redirect agent output\n");
+        return -1;
+    }
+    dup2(devnull, STDOUT_FILENO);
+    close(devnull);
+
+    double samples[MAX_REPS];
+    bool regressed = false;
+    for (size_t b = 0; b < sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]); ++b) {
+        const bench_t *bench = &BENCHMARKS[b];
+        if (filter && !strstr(bench->name, filter))
+            continue;
+
+        for (const char *const *param = bench->params; *param; ++param) {
+            // Every repetition gets its own seed, and the same seeds are used on every run
+            for (int i = 0; i < warmup; ++i)
+                bench->run(*param, seed + reps + i);
+
+            // A counter is only reported if every repetition could read it
+            double counters[PERF_COUNTER_COUNT] = {0};
+            uint64_t steps = 0;
+            for (int i = 0; i < reps; ++i) {
+                uint64_t values[PERF_COUNTER_COUNT];
+                samples[i] = measure(bench, *param, seed + i, values);
+                steps += rep_steps;
+                for (int c = 0; c < PERF_COUNTER_COUNT; ++c)
+                    counters[c] += values[c] == PERF_UNAVAILABLE ? NAN : (double) values[c] / reps;
+            }
+            double misses_per_step = steps > 0 ? counters[PERF_LLC_MISSES] * reps / steps : NAN;
+
+            report(bench, *param, seed, warmup, samples, reps, counters, misses_per_step);
+            if (baseline_path)
+                regressed |= check_regression(baseline, baseline_count, threshold, bench, *param, seed,
+                        samples_mean(samples, reps), misses_per_step);
+        }
+    }
+
+    if (pool_ready)
+        server_destroy(&pool);
+    perf_results_destroy(agent_perf);
+
+    fclose(out);
+    return regressed ? 1 : 0;
+}
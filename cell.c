@@ -0,0 +1,73 @@
+/**
+ * @file cell.c
+ * @brief Lock-free operations on a single grid cell
+ */
+
+#include <semaphore.h>
+#include <sched.h>
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "barrier.h"
+#include "repairmen.h"
+
+void cell_init(cell_t *cell, bool fixed) {
+    atomic_init(&cell->fixed, fixed);
+    for (int k = 0; k < AGENT_COUNT; ++k)
+        atomic_init(&cell->log[k], 0);
+    atomic_init(&cell->log_seq, 0);
+    atomic_init(&cell->occupant, CELL_EMPTY);
+}
+
+bool cell_try_occupy(cell_t *cell, int id) {
+    int expected = CELL_EMPTY;
+    return atomic_compare_exchange_strong_explicit(&cell->occupant, &expected, id,
+            memory_order_acq_rel, memory_order_relaxed);
+}
+
+void cell_release(cell_t *cell) {
+    atomic_store_explicit(&cell->occupant, CELL_EMPTY, memory_order_release);
+}
+
+bool cell_claim_repair(cell_t *cell) {
+    bool expected = false;
+    return atomic_compare_exchange_strong_explicit(&cell->fixed, &expected, true,
+            memory_order_acq_rel, memory_order_relaxed);
+}
+
+void cell_log_write(cell_t *cell, int id, int value) {
+    // Writers serialize on the sequence by moving it from even to odd
+    unsigned seq = atomic_load_explicit(&cell->log_seq, memory_order_relaxed);
+    while (true) {
+        if (seq % 2 == 0 && atomic_compare_exchange_weak_explicit(&cell->log_seq, &seq, seq + 1,
+                    memory_order_acquire, memory_order_relaxed))
+            break;
+
+        sched_yield();
+        seq = atomic_load_explicit(&cell->log_seq, memory_order_relaxed);
+    }
+
+    // Keep the entry store from being reordered before the sequence becomes odd
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&cell->log[id], value, memory_order_relaxed);
+
+    atomic_store_explicit(&cell->log_seq, seq + 2, memory_order_release);
+}
+
+void cell_log_read(cell_t *cell, int log[AGENT_COUNT]) {
+    while (true) {
+        unsigned before = atomic_load_explicit(&cell->log_seq, memory_order_acquire);
+        if (before % 2 == 0) {
+            for (int k = 0; k < AGENT_COUNT; ++k)
+                log[k] = atomic_load_explicit(&cell->log[k], memory_order_relaxed);
+
+            // Retry if a writer got in while we were copying
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&cell->log_seq, memory_order_relaxed) == before)
+                return;
+        }
+
+        sched_yield();
+    }
+}
@@ -0,0 +1,240 @@
+/**
+ * @file coverage.c
+ * @brief Implementation for a shared map of explored cells guiding agent moves
+ */
+
+#include <sys/mman.h>
+#include <semaphore.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "coverage.h"
+
+/** Moves leading to the four neighbours of a cell, in MOVE_DELTA order */
+#define NEIGHBOUR_FIRST 1
+
+static int cell_index(const int pos[2]) {
+    return pos[0] * GRID_SIZE + pos[1];
+}
+
+static bool in_bounds(const coverage_t *coverage, int x, int y) {
+    return 0 <= x && x < coverage->bounds[0] && 0 <= y && y < coverage->bounds[1];
+}
+
+static bool is_known_fixed(coverage_t *coverage, int c) {
+    return atomic_load_explicit(&coverage->known_fixed[c / 64], memory_order_relaxed) & (1ull << (c % 64));
+}
+
+static void mark_dirty(coverage_t *coverage, const int pos[2]) {
+    int tile = (pos[0] / COVERAGE_TILE) * COVERAGE_TILE_ROW + pos[1] / COVERAGE_TILE;
+    atomic_fetch_or_explicit(&coverage->dirty[tile / 64], 1ull << (tile % 64), memory_order_release);
+}
+
+static uint16_t get_dist(coverage_t *coverage, int c) {
+    return atomic_load_explicit(&coverage->dist[c / GRID_SIZE][c % GRID_SIZE], memory_order_relaxed);
+}
+
+static void set_dist(coverage_t *coverage, int c, uint16_t dist) {
+    atomic_store_explicit(&coverage->dist[c / GRID_SIZE][c % GRID_SIZE], dist, memory_order_relaxed);
+}
+
+coverage_t *coverage_create(const int bounds[2]) {
+    coverage_t *coverage = mmap(NULL, sizeof(coverage_t), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (coverage == MAP_FAILED)
+        return NULL;
+
+    coverage->bounds[0] = bounds[0];
+    coverage->bounds[1] = bounds[1];
+    coverage_reset(coverage);
+    return coverage;
+}
+
+void coverage_destroy(coverage_t *coverage) {
+    munmap(coverage, sizeof(coverage_t));
+}
+
+void coverage_reset(coverage_t *coverage) {
+    memset(coverage->visited, 0, sizeof(coverage->visited));
+    memset(coverage->known_fixed, 0, sizeof(coverage->known_fixed));
+    memset(coverage->dirty, 0, sizeof(coverage->dirty));
+    memset(coverage->queued, 0, sizeof(coverage->queued));
+    atomic_flag_clear(&coverage->updating);
+
+    // Nothing is explored yet, so every cell in the grid is its own closest target
+    for (int i = 0; i < GRID_SIZE; ++i) {
+        for (int j = 0; j < GRID_SIZE; ++j) {
+            bool inside = in_bounds(coverage, i, j);
+            atomic_init(&coverage->dist[i][j], inside ? 0 : COVERAGE_FAR);
+            coverage->target[i * GRID_SIZE + j] = inside ? i * GRID_SIZE + j : -1;
+        }
+    }
+}
+
+void coverage_visit(coverage_t *coverage, const int pos[2]) {
+    if (!coverage)
+        return;
+
+    int c = cell_index(pos);
+    uint64_t bit = 1ull << (c % 64);
+    atomic_fetch_or_explicit(&coverage->visited[c / 64], bit, memory_order_relaxed);
+    if (!(atomic_fetch_or_explicit(&coverage->known_fixed[c / 64], bit, memory_order_relaxed) & bit))
+        mark_dirty(coverage, pos);
+}
+
+void coverage_mark_broken(coverage_t *coverage, const int pos[2]) {
+    if (!coverage)
+        return;
+
+    int c = cell_index(pos);
+    uint64_t bit = 1ull << (c % 64);
+    if (atomic_fetch_and_explicit(&coverage->known_fixed[c / 64], ~bit, memory_order_relaxed) & bit)
+        mark_dirty(coverage, pos);
+}
+
+/**
+ * Queue a cell whose neighbours may get closer to a target through it
+ */
+static void push_lower(coverage_t *coverage, int c, int *tail) {
+    if (coverage->queued[c])
+        return;
+    coverage->queued[c] = true;
+    coverage->lower[*tail % COVERAGE_CELLS] = c;
+    (*tail) ++;
+}
+
+/**
+ * Compare the cells of a dirty region with the field, and start the waves from the cells that changed
+ */
+static int scan_tile(coverage_t *coverage, int tile, int *n_raise, int *tail) {
+    int written = 0;
+    int x0 = (tile / COVERAGE_TILE_ROW) * COVERAGE_TILE, y0 = (tile % COVERAGE_TILE_ROW) * COVERAGE_TILE;
+
+    for (int x = x0; x < x0 + COVERAGE_TILE; ++x) {
+        for (int y = y0; y < y0 + COVERAGE_TILE; ++y) {
+            if (!in_bounds(coverage, x, y))
+                continue;
+
+            int c = x * GRID_SIZE + y;
+            bool is_target = !is_known_fixed(coverage, c);
+            uint16_t dist = get_dist(coverage, c);
+            if (is_target && dist != 0) {
+                set_dist(coverage, c, 0);
+                coverage->target[c] = c;
+                push_lower(coverage, c, tail);
+                written ++;
+            }
+            else if (!is_target && dist == 0) {
+                set_dist(coverage, c, COVERAGE_FAR);
+                coverage->target[c] = -1;
+                coverage->raise[(*n_raise)++] = c;
+                written ++;
+            }
+        }
+    }
+
+    return written;
+}
+
+int coverage_update(coverage_t *coverage) {
+    if (!coverage || atomic_flag_test_and_set_explicit(&coverage->updating, memory_order_acquire))
+        return 0;
+
+    int written = 0, n_raise = 0, head = 0, tail = 0;
+
+    // Dirty bits set from here on are picked up by the next update
+    for (int w = 0; w < COVERAGE_TILE_WORDS; ++w) {
+        uint64_t bits = atomic_exchange_explicit(&coverage->dirty[w], 0, memory_order_acquire);
+        while (bits) {
+            int b = __builtin_ctzll(bits);
+            bits &= bits - 1;
+            written += scan_tile(coverage, w * 64 + b, &n_raise, &tail);
+        }
+    }
+
+    // Clear every cell measured to a target that is gone. Those cells are connected to the target
+    // through cells measured to it too, and the cells around them still have a valid distance.
+    for (int i = 0; i < n_raise; ++i) {
+        int c = coverage->raise[i], pos[2] = {c / GRID_SIZE, c % GRID_SIZE};
+        for (int dir = NEIGHBOUR_FIRST; dir < DIRECTION_COUNT; ++dir) {
+            int x = pos[0] + MOVE_DELTA[dir][0], y = pos[1] + MOVE_DELTA[dir][1];
+            if (!in_bounds(coverage, x, y))
+                continue;
+
+            int n = x * GRID_SIZE + y, target = coverage->target[n];
+            if (target == -1)
+                continue;
+
+            if (get_dist(coverage, target) != 0) {
+                set_dist(coverage, n, COVERAGE_FAR);
+                coverage->target[n] = -1;
+                coverage->raise[n_raise++] = n;
+                written ++;
+            }
+            else {
+                push_lower(coverage, n, &tail);
+            }
+        }
+    }
+
+    // Grow distances back from the new targets and the edge of the cleared cells
+    while (head != tail) {
+        int c = coverage->lower[head % COVERAGE_CELLS], pos[2] = {c / GRID_SIZE, c % GRID_SIZE};
+        head ++;
+        coverage->queued[c] = false;
+
+        uint16_t dist = get_dist(coverage, c) + 1;
+        for (int dir = NEIGHBOUR_FIRST; dir < DIRECTION_COUNT; ++dir) {
+            int x = pos[0] + MOVE_DELTA[dir][0], y = pos[1] + MOVE_DELTA[dir][1];
+            if (!in_bounds(coverage, x, y))
+                continue;
+
+            int n = x * GRID_SIZE + y;
+            if (dist < get_dist(coverage, n)) {
+                set_dist(coverage, n, dist);
+                coverage->target[n] = coverage->target[c];
+                push_lower(coverage, n, &tail);
+                written ++;
+            }
+        }
+    }
+
+    atomic_flag_clear_explicit(&coverage->updating, memory_order_release);
+    return written;
+}
+
+int coverage_best_dir(const coverage_t *coverage, const int pos[2]) {
+    int best = -1, ties = 0;
+    uint16_t best_dist = COVERAGE_FAR;
+
+    for (int dir = NEIGHBOUR_FIRST; dir < DIRECTION_COUNT; ++dir) {
+        int x = pos[0] + MOVE_DELTA[dir][0], y = pos[1] + MOVE_DELTA[dir][1];
+        if (!in_bounds(coverage, x, y))
+            continue;
+
+        uint16_t dist = atomic_load_explicit((atomic_ushort *) &coverage->dist[x][y], memory_order_relaxed);
+        if (dist < best_dist) {
+            best = dir;
+            best_dist = dist;
+            ties = 1;
+        }
+        else if (dist == best_dist && best != -1 && rand() % ++ties == 0) {
+            best = dir;
+        }
+    }
+
+    return best;
+}
+
+int coverage_count_visited(const coverage_t *coverage) {
+    int count = 0;
+    for (int w = 0; w < COVERAGE_WORDS; ++w)
+        count += __builtin_popcountll(atomic_load_explicit((atomic_ullong *) &coverage->visited[w], memory_order_relaxed));
+    return count;
+}
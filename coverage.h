@@ -0,0 +1,126 @@
+/**
+ * @file coverage.h
+ * @brief Public interface for a shared map of explored cells guiding agent moves
+ */
+
+#ifndef COVERAGE_H_
+#define COVERAGE_H_
+
+/** Width and height of the regions the map tracks changes in */
+#define COVERAGE_TILE 8
+
+/** Distance of cells with nothing left to explore anywhere */
+#define COVERAGE_FAR UINT16_MAX
+
+/** Number of cells in the dense grid */
+#define COVERAGE_CELLS (GRID_SIZE * GRID_SIZE)
+
+/** Number of 64 bit words in a bitmap with one bit per cell */
+#define COVERAGE_WORDS ((COVERAGE_CELLS + 63) / 64)
+
+/** Number of regions in each row and column of the grid */
+#define COVERAGE_TILE_ROW ((GRID_SIZE + COVERAGE_TILE - 1) / COVERAGE_TILE)
+
+/** Number of 64 bit words in a bitmap with one bit per region */
+#define COVERAGE_TILE_WORDS ((COVERAGE_TILE_ROW * COVERAGE_TILE_ROW + 63) / 64)
+
+/**
+ * Coverage bitmaps and distance field shared by agents
+ *
+ * Cells that aren't known to be fixed, either never visited or broken again by an injected failure,
+ * are worth going to. The distance field holds the number of moves from each cell to the closest
+ * of them, so an agent picks its move by reading its four neighbours.
+ *
+ * Agents only set bits in the bitmaps and mark the region they changed as dirty. The field is then
+ * brought up to date by a single updater at a time, which clears the field around cells that stopped
+ * being worth going to and grows it back from the cells around them and from new ones.
+ * Only cells whose closest target changed are touched.
+ */
+struct coverage {
+    atomic_ullong visited[COVERAGE_WORDS];          ///< Bit set for every cell an agent has stood on
+    atomic_ullong known_fixed[COVERAGE_WORDS];      ///< Bit set for every cell an agent has left fixed
+    atomic_ullong dirty[COVERAGE_TILE_WORDS];       ///< Bit set for every region with a known_fixed change since the last update
+    atomic_ushort dist[GRID_SIZE][GRID_SIZE];       ///< Moves to the closest cell not known to be fixed, or COVERAGE_FAR
+    atomic_flag updating;                           ///< Held by the agent currently updating the distance field
+    int bounds[2];                                  ///< Number of rows and columns of the grid in use
+
+    // Only used by the updater
+    int target[COVERAGE_CELLS];         ///< Row-major index of the closest cell the distance is measured to, or -1
+    int raise[COVERAGE_CELLS];          ///< Cells whose distance was cleared in this update
+    int lower[COVERAGE_CELLS];          ///< Ring of cells whose neighbours may get closer
+    unsigned char queued[COVERAGE_CELLS];   ///< True for cells in lower
+};
+
+/**
+ * @brief Create a map with no cell explored in memory shared with child processes
+ *
+ * @param[in] bounds    Number of rows and columns of the grid in use, at most GRID_SIZE each
+ *
+ * @return Pointer to the map on success, otherwise returns NULL and sets errno to indicate error
+ */
+coverage_t *coverage_create(const int bounds[2]);
+
+/**
+ * @brief Free a map created with coverage_create
+ *
+ * @param[in] coverage  Pointer to the map
+ */
+void coverage_destroy(coverage_t *coverage);
+
+/**
+ * @brief Forget every explored cell, must not be called while agents use the map
+ *
+ * @param[in] coverage  Pointer to the map
+ */
+void coverage_reset(coverage_t *coverage);
+
+/**
+ * @brief Record that an agent stood on a cell and left it fixed
+ *
+ * @param[in] coverage  Pointer to the map, nothing is done if NULL
+ * @param[in] pos       (x,y) position of the cell
+ */
+void coverage_visit(coverage_t *coverage, const int pos[2]);
+
+/**
+ * @brief Record that a cell broke and is worth going to again
+ *
+ * @param[in] coverage  Pointer to the map, nothing is done if NULL
+ * @param[in] pos       (x,y) position of the cell
+ */
+void coverage_mark_broken(coverage_t *coverage, const int pos[2]);
+
+/**
+ * @brief Bring the distance field up to date with the dirty regions
+ *
+ * Returns right away if another agent is updating the field. Agents reading the field during an
+ * update may see COVERAGE_FAR on cells whose distance is being recomputed.
+ *
+ * @param[in] coverage  Pointer to the map, nothing is done if NULL
+ *
+ * @return Number of distances written, cells cleared and grown back again count twice
+ */
+int coverage_update(coverage_t *coverage);
+
+/**
+ * @brief Pick the move towards the closest cell worth going to
+ *
+ * Ties between neighbours are broken at random.
+ *
+ * @param[in] coverage  Pointer to the map
+ * @param[in] pos       Current (x,y) position
+ *
+ * @return Index of the direction in MOVE_DELTA, or -1 if no neighbour leads anywhere
+ */
+int coverage_best_dir(const coverage_t *coverage, const int pos[2]);
+
+/**
+ * @brief Count the cells agents have stood on
+ *
+ * @param[in] coverage  Pointer to the map
+ *
+ * @return Number of visited cells
+ */
+int coverage_count_visited(const coverage_t *coverage);
+
+#endif // COVERAGE_H_
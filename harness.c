@@ -0,0 +1,74 @@
+/**
+ * @file harness.c
+ * @brief Implementation for running agents as threads, shared by the thread mode, tests and benchmarks
+ */
+
+#include <sys/mman.h>
+#include <semaphore.h>
+#include <pthread.h>
+
+#include <stdbool.h>
+#include <errno.h>
+#include <stdatomic.h>
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "harness.h"
+
+shared_mem_t *harness_map(void) {
+    shared_mem_t *mem = mmap(NULL, sizeof(shared_mem_t), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return NULL;
+
+    if (initialize_shared_mem(mem) != 0) {
+        munmap(mem, sizeof(shared_mem_t));
+        return NULL;
+    }
+    mem->pacing_us = 0;
+    return mem;
+}
+
+void harness_unmap(shared_mem_t *mem) {
+    cleanup_shared_mem(mem);
+    munmap(mem, sizeof(shared_mem_t));
+}
+
+static void *agent_thread(void *data) {
+    harness_agent_t *args = data;
+    agent(args->mem, args->id, args->target);
+    return NULL;
+}
+
+int harness_start_each(harness_t *harness, shared_mem_t *mem, const int targets[AGENT_COUNT]) {
+    for (int i = 0; i < AGENT_COUNT; ++i) {
+        harness->args[i] = (harness_agent_t) {mem, i, targets[i]};
+        int status = pthread_create(&harness->thread[i], NULL, agent_thread, &harness->args[i]);
+        if (status != 0) {
+            errno = status;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int harness_start(harness_t *harness, shared_mem_t *mem, int target) {
+    int targets[AGENT_COUNT];
+    for (int i = 0; i < AGENT_COUNT; ++i)
+        targets[i] = target;
+    return harness_start_each(harness, mem, targets);
+}
+
+void harness_join(harness_t *harness) {
+    for (int i = 0; i < AGENT_COUNT; ++i)
+        pthread_join(harness->thread[i], NULL);
+}
+
+int harness_run(shared_mem_t *mem, int target) {
+    harness_t harness;
+    if (harness_start(&harness, mem, target) != 0)
+        return -1;
+
+    harness_join(&harness);
+    return 0;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file harness.h
+ * @brief Helpers for running agents as threads, shared by the thread mode, tests and benchmarks
+ */
+
+#ifndef HARNESS_H_
+#define HARNESS_H_
+
+/** Repair target nobody reaches, so a run only ends once every broken cell is fixed */
+#define HARNESS_NO_TARGET (GRID_SIZE * GRID_SIZE + 1)
+
+/** Arguments of one agent thread */
+typedef struct {
+    shared_mem_t *mem;  ///< Shared memory of the run
+    int id;             ///< Id of the agent
+    int target;         ///< Number of cells the agent aims to repair before exiting
+} harness_agent_t;
+
+/** Agents running as threads of the calling process */
+typedef struct {
+    pthread_t thread[AGENT_COUNT];      ///< Thread of each agent
+    harness_agent_t args[AGENT_COUNT];  ///< Arguments of each agent
+} harness_t;
+
+/**
+ * @brief Map and initialize shared memory for an unpaced lockstep run
+ *
+ * @return Pointer to the shared memory on success, otherwise returns NULL and sets errno to indicate error
+ */
+shared_mem_t *harness_map(void);
+
+/**
+ * @brief Clean up and unmap shared memory mapped with harness_map
+ *
+ * @param[in] mem   Pointer to the shared memory
+ */
+void harness_unmap(shared_mem_t *mem);
+
+/**
+ * @brief Start every agent on its own thread, each with its own repair target
+ *
+ * @param[out] harness  Threads of the agents
+ * @param[in] mem       Pointer to the initialized shared memory
+ * @param[in] targets   Repair target of each agent
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error
+ */
+int harness_start_each(harness_t *harness, shared_mem_t *mem, const int targets[AGENT_COUNT]);
+
+/**
+ * @brief Start every agent on its own thread
+ *
+ * @param[out] harness  Threads of the agents
+ * @param[in] mem       Pointer to the initialized shared memory
+ * @param[in] target    Repair target of every agent
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error
+ */
+int harness_start(harness_t *harness, shared_mem_t *mem, int target);
+
+/**
+ * @brief Wait for every agent started with harness_start to exit
+ *
+ * @param[in] harness   Threads of the agents
+ */
+void harness_join(harness_t *harness);
+
+/**
+ * @brief Run every agent on its own thread until they all exit
+ *
+ * @param[in] mem       Pointer to the initialized shared memory
+ * @param[in] target    Repair target of every agent
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error
+ */
+int harness_run(shared_mem_t *mem, int target);
+
+#endif // HARNESS_H_
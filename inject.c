@@ -0,0 +1,144 @@
+/**
+ * @file inject.c
+ * @brief Implementation for streaming new failures into a running simulation
+ */
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <semaphore.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "inject.h"
+#include "stats.h"
+#include "coverage.h"
+
+inject_queue_t *inject_create(void) {
+    inject_queue_t *queue = mmap(NULL, sizeof(inject_queue_t), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (queue == MAP_FAILED)
+        return NULL;
+
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_flag_clear(&queue->draining);
+    atomic_init(&queue->closed, false);
+    atomic_init(&queue->finished, false);
+
+    return queue;
+}
+
+void inject_destroy(inject_queue_t *queue) {
+    munmap(queue, sizeof(inject_queue_t));
+}
+
+bool inject_push(inject_queue_t *queue, const int pos[2]) {
+    uint64_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head - tail == INJECT_QUEUE_SIZE)
+        return false;
+
+    int *slot = queue->cells[head & (INJECT_QUEUE_SIZE - 1)];
+    slot[0] = pos[0];
+    slot[1] = pos[1];
+
+    // Publishes the slot to the consumer
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool inject_pop(inject_queue_t *queue, int pos[2]) {
+    uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (head == tail)
+        return false;
+
+    int *slot = queue->cells[tail & (INJECT_QUEUE_SIZE - 1)];
+    pos[0] = slot[0];
+    pos[1] = slot[1];
+
+    // Hands the slot back to the producer
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+void inject_close(inject_queue_t *queue) {
+    atomic_store_explicit(&queue->closed, true, memory_order_release);
+}
+
+bool inject_finished(inject_queue_t *queue) {
+    return !queue || atomic_load_explicit(&queue->finished, memory_order_acquire);
+}
+
+int inject_drain(shared_mem_t *mem) {
+    inject_queue_t *queue = mem->inject;
+    if (!queue || atomic_flag_test_and_set_explicit(&queue->draining, memory_order_acquire))
+        return 0;
+
+    // Closing before the last pop is seen means nothing can be pushed after it
+    bool closed = atomic_load_explicit(&queue->closed, memory_order_acquire);
+
+    int injected = 0, pos[2];
+    while (inject_pop(queue, pos)) {
+        cell_t *cell = grid_cell(mem, pos);
+        if (!cell)
+            continue;
+
+        // Agents may be standing on the cell in relaxed mode, they see the failure on their next step
+        bool fixed = true;
+        if (!atomic_compare_exchange_strong_explicit(&cell->fixed, &fixed, false,
+                    memory_order_acq_rel, memory_order_relaxed))
+            continue;
+
+        atomic_fetch_add_explicit(&mem->total_broken, 1, memory_order_relaxed);
+        stats_record_inject(mem->stats);
+        coverage_mark_broken(mem->coverage, pos);
+        injected ++;
+    }
+
+    if (closed)
+        atomic_store_explicit(&queue->finished, true, memory_order_release);
+
+    atomic_flag_clear_explicit(&queue->draining, memory_order_release);
+    return injected;
+}
+
+uint64_t inject_run(shared_mem_t *mem, const uint64_t *cells, uint64_t count, double rate, unsigned seed) {
+    inject_queue_t *queue = mem->inject;
+    uint64_t start = stats_now_ns(), pushed = 0;
+
+    while (pushed < count && atomic_load_explicit(&mem->running, memory_order_acquire) > 0) {
+        // Failure i is due i / rate seconds after the start, so late pushes catch up
+        uint64_t due = start + (uint64_t) (pushed * 1e9 / rate);
+        uint64_t now = stats_now_ns();
+        if (now < due) {
+            struct timespec ts = {(due - now) / 1000000000ull, (due - now) % 1000000000ull};
+            nanosleep(&ts, NULL);
+            continue;
+        }
+
+        int pos[2];
+        if (cells) {
+            pos[0] = cells[pushed] / mem->bounds[1];
+            pos[1] = cells[pushed] % mem->bounds[1];
+        }
+        else {
+            pos[0] = rand_r(&seed) % mem->bounds[0];
+            pos[1] = rand_r(&seed) % mem->bounds[1];
+        }
+
+        if (inject_push(queue, pos))
+            pushed ++;
+        else
+            usleep(1000);
+    }
+
+    inject_close(queue);
+    return pushed;
+}
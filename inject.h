@@ -0,0 +1,108 @@
+/**
+ * @file inject.h
+ * @brief Public interface for streaming new failures into a running simulation
+ */
+
+#ifndef INJECT_H_
+#define INJECT_H_
+
+/** Number of failures the injection queue can hold, a power of two */
+#define INJECT_QUEUE_SIZE 1024
+
+/**
+ * Lock-free single producer, single consumer ring of cells to break
+ *
+ * The injector pushes cells as failures happen, and agents drain the queue at round boundaries.
+ * Agents draining in relaxed mode take the draining flag first, so there is only ever one consumer.
+ * Head and tail only grow and are kept on separate cache lines.
+ */
+struct inject_queue {
+    _Alignas(64) atomic_ullong head;    ///< Number of cells pushed so far, written by the producer
+    _Alignas(64) atomic_ullong tail;    ///< Number of cells popped so far, written by the consumer
+    atomic_flag draining;               ///< Held by the agent currently draining the queue
+    atomic_bool closed;                 ///< True once the producer has pushed its last cell
+    atomic_bool finished;               ///< True once the queue is closed and every cell has been applied
+    int cells[INJECT_QUEUE_SIZE][2];    ///< (x,y) position of each queued cell
+};
+
+/**
+ * @brief Create an empty injection queue in memory shared with child processes
+ *
+ * @return Pointer to the queue on success, otherwise returns NULL and sets errno to indicate error
+ */
+inject_queue_t *inject_create(void);
+
+/**
+ * @brief Free an injection queue created with inject_create
+ *
+ * @param[in] queue Pointer to the queue
+ */
+void inject_destroy(inject_queue_t *queue);
+
+/**
+ * @brief Queue a cell to break, only called by the producer
+ *
+ * @param[in] queue Pointer to the queue
+ * @param[in] pos   (x,y) position of the cell
+ *
+ * @return true if the cell was queued, false if the queue is full
+ */
+bool inject_push(inject_queue_t *queue, const int pos[2]);
+
+/**
+ * @brief Take the oldest queued cell, only called by the consumer
+ *
+ * @param[in] queue Pointer to the queue
+ * @param[out] pos  (x,y) position of the cell
+ *
+ * @return true if a cell was taken, false if the queue is empty
+ */
+bool inject_pop(inject_queue_t *queue, int pos[2]);
+
+/**
+ * @brief Mark that the producer won't push any more cells
+ *
+ * @param[in] queue Pointer to the queue
+ */
+void inject_close(inject_queue_t *queue);
+
+/**
+ * @brief Check whether every failure has been injected
+ *
+ * Until then agents can't know the final number of broken cells, so they don't exit on it.
+ *
+ * @param[in] queue Pointer to the queue, or NULL when nothing is injected
+ *
+ * @return true if queue is NULL or closed and drained
+ */
+bool inject_finished(inject_queue_t *queue);
+
+/**
+ * @brief Break every queued cell of the grid
+ *
+ * Fixed cells are marked broken, counted in mem->total_broken and the live statistics, and marked
+ * as worth going to again on the coverage map. Cells that are already broken are skipped. Returns right away if another agent is draining the queue.
+ *
+ * @param[in] mem   Pointer to the shared memory structure, nothing is done if mem->inject is NULL
+ *
+ * @return Number of cells that were broken
+ */
+int inject_drain(shared_mem_t *mem);
+
+/**
+ * @brief Feed failures into the queue of a running simulation at a steady rate, then close it
+ *
+ * Runs as the producer until count failures are queued or every agent has exited. When the
+ * queue is full, the next failure waits for agents to drain it.
+ *
+ * @param[in] mem       Pointer to the shared memory structure with mem->inject set
+ * @param[in] cells     Row-major index of each cell to break in order, or NULL to pick cells at random
+ * @param[in] count     Number of failures to inject
+ * @param[in] rate      Number of failures per second
+ * @param[in] seed      Seed for picking random cells
+ *
+ * @return Number of failures queued
+ */
+uint64_t inject_run(shared_mem_t *mem, const uint64_t *cells, uint64_t count, double rate, unsigned seed);
+
+#endif // INJECT_H_
@@ -0,0 +1,142 @@
+/**
+ * @file kernels.c
+ * @brief Implementation for step kernels specialized at compile time
+ *
+ * Each piece of the step is written once as an always inlined template taking the agent count
+ * and grid size as arguments. The specializations are thin wrappers passing constants, so the
+ * compiler unrolls and folds them, while the generic kernel passes its runtime arguments through.
+ */
+
+#include <semaphore.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "kernels.h"
+
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+ALWAYS_INLINE void merge_log_template(int fixed[], const int log[], int n) {
+    for (int i = 0; i < n; ++i)
+        fixed[i] = fixed[i] < log[i] ? log[i] : fixed[i];
+}
+
+ALWAYS_INLINE bool should_exit_template(const int fixed[], int n, int id, int target, int total_broken) {
+    int total_fixed = 0;
+    for (int i = 0; i < n; ++i)
+        total_fixed += fixed[i];
+    return fixed[id] == target || total_fixed == total_broken;
+}
+
+ALWAYS_INLINE bool same_pos(const int first[2], const int second[2]) {
+    return first[0] == second[0] && first[1] == second[1];
+}
+
+// Same priority rules as update_positions
+ALWAYS_INLINE void update_positions_template(int pos[][2], const action_t action[], int dest[][2], int n) {
+    int new_pos[n][2];
+    for (int i = 0; i < n; ++i) {
+        new_pos[i][0] = dest[i][0];
+        new_pos[i][1] = dest[i][1];
+    }
+
+    for (int k = 0; k < n; ++k) {
+        for (int i = 0; i < n; ++i) {
+            if (action[i] == ACT_DIE)
+                continue;
+
+            for (int j = i+1; j < n; ++j) {
+                if (action[j] == ACT_DIE || !same_pos(new_pos[i], new_pos[j]))
+                    continue;
+
+                // Agents staying put win, then lower indices win
+                int loser = !same_pos(pos[i], new_pos[i]) && same_pos(pos[j], new_pos[j]) ? i : j;
+                new_pos[loser][0] = pos[loser][0];
+                new_pos[loser][1] = pos[loser][1];
+            }
+        }
+    }
+
+    for (int i = 0; i < n; ++i) {
+        pos[i][0] = new_pos[i][0];
+        pos[i][1] = new_pos[i][1];
+    }
+}
+
+ALWAYS_INLINE void apply_move_template(const int pos[2], int dir, int rows, int cols, int new_pos[2]) {
+    int x = pos[0] + MOVE_DELTA[dir][0];
+    int y = pos[1] + MOVE_DELTA[dir][1];
+
+    // Reverse the direction if we go out of the bounds
+    x += x < 0 ? 2 : 0;
+    x -= rows - 1 < x ? 2 : 0;
+    y += y < 0 ? 2 : 0;
+    y -= cols - 1 < y ? 2 : 0;
+
+    new_pos[0] = x;
+    new_pos[1] = y;
+}
+
+/**
+ * Defines the functions and kernel_t of one configuration. A zero agent count or grid size
+ * leaves that dimension to the runtime arguments.
+ */
+#define DEFINE_KERNEL(N, G, NAME) \
+    static void merge_log_##N##_##G(int fixed[], const int log[], int n) { \
+        merge_log_template(fixed, log, N ? N : n); \
+    } \
+    static bool should_exit_##N##_##G(const int fixed[], int n, int id, int target, int total_broken) { \
+        return should_exit_template(fixed, N ? N : n, id, target, total_broken); \
+    } \
+    static void update_positions_##N##_##G(int pos[][2], const action_t action[], int dest[][2], int n) { \
+        update_positions_template(pos, action, dest, N ? N : n); \
+    } \
+    static void apply_move_##N##_##G(const int pos[2], int dir, const int bounds[2], int new_pos[2]) { \
+        apply_move_template(pos, dir, G ? G : bounds[0], G ? G : bounds[1], new_pos); \
+    } \
+    static const kernel_t KERNEL_##N##_##G = { \
+        NAME, N, G, \
+        merge_log_##N##_##G, should_exit_##N##_##G, update_positions_##N##_##G, apply_move_##N##_##G \
+    };
+
+/**
+ * Configurations with a specialized kernel, as (agents, grid size). The agent count is fixed at
+ * compile time, so only AGENT_COUNT is specialized.
+ */
+#define KERNEL_CONFIGS(X) \
+    X(AGENT_COUNT, 8)   X(AGENT_COUNT, 16)  X(AGENT_COUNT, 32)  X(AGENT_COUNT, 64) \
+    X(AGENT_COUNT, 128) X(AGENT_COUNT, 256) X(AGENT_COUNT, 512) X(AGENT_COUNT, 1024) \
+    X(AGENT_COUNT, 0)
+
+// Extra levels of expansion, so AGENT_COUNT is replaced by its value before # and ##
+#define STRINGIFY(X) #X
+#define KERNEL_NAME(N, G) STRINGIFY(N) "x" STRINGIFY(G)
+#define KERNEL_REF(N, G) &KERNEL_##N##_##G
+
+#define DEFINE_CONFIG(N, G) DEFINE_KERNEL(N, G, KERNEL_NAME(N, G))
+KERNEL_CONFIGS(DEFINE_CONFIG)
+
+DEFINE_KERNEL(0, 0, "generic")
+
+#define LIST_CONFIG(N, G) KERNEL_REF(N, G),
+static const kernel_t *const KERNELS[] = {
+    KERNEL_CONFIGS(LIST_CONFIG)
+};
+
+const kernel_t *kernel_select(int agents, const int bounds[2]) {
+    // Configurations with an exact grid size come before the ones for any size
+    int grid_size = bounds[0] == bounds[1] ? bounds[0] : 0;
+    for (size_t i = 0; i < sizeof(KERNELS) / sizeof(KERNELS[0]); ++i)
+        if (KERNELS[i]->agents == agents && (KERNELS[i]->grid_size == grid_size || KERNELS[i]->grid_size == 0))
+            return KERNELS[i];
+
+    return &KERNEL_0_0;
+}
+
+const kernel_t *kernel_generic(void) {
+    return &KERNEL_0_0;
+}
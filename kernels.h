@@ -0,0 +1,51 @@
+/**
+ * @file kernels.h
+ * @brief Step kernels specialized at compile time for the agent count and common grid sizes
+ */
+
+#ifndef KERNELS_H_
+#define KERNELS_H_
+
+/**
+ * The pieces of a simulation step, for a given number of agents and grid size
+ *
+ * Specialized kernels have the agent count and grid size built in as constants, so loops have
+ * fixed trip counts and bounds checks compare against immediates. Their n and bounds arguments
+ * must match the configuration they were selected for. The generic kernel works for any.
+ */
+struct kernel {
+    const char *name;   ///< Name of the configuration, e.g. "4x64" for 4 agents on a 64x64 grid
+    int agents;         ///< Number of agents the kernel is specialized for, 0 for any
+    int grid_size;      ///< Width and height of the grid the kernel is specialized for, 0 for any
+
+    /** Merge a cell log into the known fix counts of n agents, keeping the larger of each pair */
+    void (*merge_log)(int fixed[], const int log[], int n);
+
+    /** Check whether agent id should exit, having reached its target or seen every broken cell fixed */
+    bool (*should_exit)(const int fixed[], int n, int id, int target, int total_broken);
+
+    /** Same as update_positions, for n agents */
+    void (*update_positions)(int pos[][2], const action_t action[], int dest[][2], int n);
+
+    /** Same as apply_move_bounded */
+    void (*apply_move)(const int pos[2], int dir, const int bounds[2], int new_pos[2]);
+};
+
+/**
+ * @brief Pick the step kernel for a configuration
+ *
+ * @param[in] agents    Number of agents
+ * @param[in] bounds    Number of rows and columns in the grid
+ *
+ * @return The kernel specialized for the configuration if there is one, otherwise the generic kernel
+ */
+const kernel_t *kernel_select(int agents, const int bounds[2]);
+
+/**
+ * @brief Get the generic step kernel
+ *
+ * @return The kernel taking agent count and grid size at runtime
+ */
+const kernel_t *kernel_generic(void);
+
+#endif // KERNELS_H_
@@ -4,6 +4,7 @@
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <semaphore.h>
+#include <pthread.h>
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -11,28 +12,317 @@
 #include <time.h>
 #include <errno.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
 
 #include "barrier.h"
 #include "repairmen.h"
+#include "shard.h"
+#include "scenario.h"
+#include "sparse.h"
+#include "stats.h"
+#include "inject.h"
+#include "server.h"
+#include "coverage.h"
+#include "harness.h"
+
+// Read the broken cells of a scenario on the grid in use, to be injected in file order
+static int load_inject_list(shared_mem_t *mem, const char *path, scenario_cells_t *list) {
+    scenario_t scenario;
+    if (scenario_open(&scenario, path) != 0)
+        return -1;
+
+    if (scenario.header->rows != (uint32_t) mem->bounds[0] || scenario.header->cols != (uint32_t) mem->bounds[1]) {
+        scenario_close(&scenario);
+        errno = EINVAL;
+        return -1;
+    }
+
+    int status = scenario_read_cells(&scenario, list);
+    scenario_close(&scenario);
+    return status;
+}
+
+// Keep simulations ready and serve runs over a Unix socket until a client asks to quit
+static int run_server(const char *path, const server_request_t *defaults) {
+    server_t server;
+    if (server_create(&server, defaults) != 0) {
+        printf("Starting the server failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (server_listen(&server, path) != 0) {
+        printf("Listening on %s failed: %s\n", path, strerror(errno));
+        server_destroy(&server);
+        return -1;
+    }
+    printf("Serving runs on %s\n", path);
+    fflush(stdout);
+
+    int status = server_serve(&server);
+    if (status != 0)
+        printf("Serving runs failed: %s\n", strerror(errno));
+
+    server_destroy(&server);
+    printf("Server stopped.\n");
+    return status;
+}
+
+// Ask a running server for a run, or to quit when no targets are given
+static int run_client(const char *path, const int targets[], const server_request_t *options, bool pacing_given) {
+    char request[SERVER_LINE_MAX] = "QUIT", reply[SERVER_LINE_MAX];
+    if (targets) {
+        int len = snprintf(request, sizeof(request), "RUN");
+        for (int i = 0; i < AGENT_COUNT; ++i)
+            len += snprintf(request + len, sizeof(request) - len, " %d", targets[i]);
+        if (options->mode == MODE_RELAXED)
+            len += snprintf(request + len, sizeof(request) - len, " staleness=%d", options->max_staleness);
+        if (pacing_given)
+            len += snprintf(request + len, sizeof(request) - len, " pacing=%d", options->pacing_us);
+    }
+
+    if (server_request(path, request, reply, sizeof(reply)) != 0) {
+        printf("Request to %s failed: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    printf("%s\n", reply);
+    return strncmp(reply, "OK", strlen("OK")) == 0 ? 0 : -1;
+}
+
+static void print_usage(void) {
+    printf("Usage: ./repairmen [-t] [-m] [-p pacing_us] [-k staleness] [-n shards [-L address]] [-f scenario [-s cells]]\n"
+           "                   [-r rate [-c count | -F scenario]] [target1] [target2] [target3] [target4]\n"
+           "       ./repairmen -J address\n"
+           "       ./repairmen -S socket [-p pacing_us] [-k staleness]\n"
+           "       ./repairmen -C socket [-p pacing_us] [-k staleness] [target1] [target2] [target3] [target4]\n"
+           "Targets are optional when a scenario is given, and override the scenario's targets\n"
+           "A client without targets asks the server to quit\n"
+           "Addresses are host:port for TCP or a Unix socket path\n");
+}
 
 int main(int argc, char *argv[]) {
     // Initialize random seed
     srand(time(NULL));
 
+    // Lockstep is used unless a staleness bound is given
+    exec_mode_t mode = MODE_LOCKSTEP;
+    int max_staleness = 0;
+
+    // Agents run as child processes unless threads are requested
+    bool use_threads = false;
+
+    // A non-zero shard count runs the grid split across that many processes, forked here unless
+    // they're to connect from elsewhere
+    int n_shards = 0;
+    const char *listen_address = NULL;
+
+    // Set when this process is one of the shards of a coordinator elsewhere
+    const char *join_address = NULL;
+
+    // Grid, starting positions and targets are generated at random unless a scenario is given
+    const char *scenario_path = NULL;
+
+    // A non-zero capacity loads the scenario into a sparse grid tracking at most that many cells
+    long long sparse_capacity = 0;
+
+    // Delay between steps of the first agent, agent i waits (i+1) times as long
+    int pacing_us = PACING_US;
+    bool pacing_given = false;
+
+    // A non-zero rate injects new failures per second while agents run, at random or from a scenario
+    double inject_rate = 0;
+    long long inject_count = 100;
+    const char *inject_path = NULL;
+
+    // Agents share a map of explored cells and head for unexplored ones instead of moving at random
+    bool use_coverage = false;
+
+    // Runs can be served by a resident server instead, or requested from one
+    const char *serve_path = NULL;
+    const char *client_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "tmp:k:n:L:J:f:s:r:c:F:S:C:")) != -1) {
+        switch (opt) {
+            case 'm':
+                use_coverage = true;
+                break;
+            case 'S':
+                serve_path = optarg;
+                break;
+            case 'C':
+                client_path = optarg;
+                break;
+            case 'r':
+                inject_rate = strtod(optarg, NULL);
+                if (inject_rate <= 0) {
+                    printf("Error: Injection rate must be a positive number\n");
+                    return -1;
+                }
+                break;
+            case 'c':
+                inject_count = strtoll(optarg, NULL, 0);
+                if (inject_count <= 0) {
+                    printf("Error: Injection count must be a positive integer\n");
+                    return -1;
+                }
+                break;
+            case 'F':
+                inject_path = optarg;
+                break;
+            case 'p':
+                pacing_us = strtol(optarg, NULL, 0);
+                if (pacing_us < 0) {
+                    printf("Error: Pacing must be a non-negative integer\n");
+                    return -1;
+                }
+                pacing_given = true;
+                break;
+            case 's':
+                sparse_capacity = strtoll(optarg, NULL, 0);
+                if (sparse_capacity <= 0) {
+                    printf("Error: Sparse grid capacity must be a positive integer\n");
+                    return -1;
+                }
+                break;
+            case 'f':
+                scenario_path = optarg;
+                break;
+            case 'n':
+                n_shards = strtol(optarg, NULL, 0);
+                if (n_shards <= 0 || GRID_SIZE < n_shards) {
+                    printf("Error: Shard count must be between 1 and %d\n", GRID_SIZE);
+                    return -1;
+                }
+                break;
+            case 'L':
+                listen_address = optarg;
+                break;
+            case 'J':
+                join_address = optarg;
+                break;
+            case 't':
+                use_threads = true;
+                break;
+            case 'k':
+                mode = MODE_RELAXED;
+                max_staleness = strtol(optarg, NULL, 0);
+                if (max_staleness < 0) {
+                    printf("Error: Staleness bound must be a non-negative integer\n");
+                    return -1;
+                }
+                break;
+            default:
+                print_usage();
+                return -1;
+        }
+    }
+
     int targets[AGENT_COUNT];
-    if (argc != 1 + AGENT_COUNT) {
-        printf("Usage: ./repairmen [target1] [target2] [target3] [target4]\n");
+    bool has_targets = argc - optind == AGENT_COUNT;
+    if (!has_targets && !((scenario_path || serve_path || client_path || join_address) && argc == optind)) {
+        print_usage();
+        return -1;
+    }
+
+    if (join_address && (has_targets || n_shards > 0 || scenario_path || serve_path || client_path || inject_rate > 0
+                || use_threads || use_coverage || mode != MODE_LOCKSTEP || pacing_given)) {
+        printf("Error: A shard gets everything else from its coordinator\n");
+        return -1;
+    }
+
+    if (listen_address && n_shards == 0) {
+        printf("Error: Listening for shards needs a shard count\n");
+        return -1;
+    }
+
+    if (use_coverage && (sparse_capacity > 0 || n_shards > 0)) {
+        printf("Error: The coverage map needs the dense grid\n");
+        return -1;
+    }
+
+    if ((serve_path || client_path) && (scenario_path || n_shards > 0 || inject_rate > 0 || use_threads || use_coverage
+                || (serve_path && (client_path || has_targets)))) {
+        printf("Error: A server or client only takes -p, -k and the client's targets\n");
+        return -1;
+    }
+
+    if (scenario_path && n_shards > 0) {
+        printf("Error: Scenarios can't be used with a sharded grid\n");
+        return -1;
+    }
+
+    if (inject_path && inject_rate <= 0) {
+        printf("Error: Injecting failures needs a rate\n");
+        return -1;
+    }
+
+    if (inject_rate > 0 && n_shards > 0) {
+        printf("Error: Failures can't be injected into a sharded grid\n");
+        return -1;
+    }
+
+    if (sparse_capacity > 0 && !scenario_path) {
+        printf("Error: A sparse grid needs a scenario\n");
         return -1;
     }
 
-    for (int i = 0; i < AGENT_COUNT; ++i) {
-        targets[i] = strtol(argv[i+1], NULL, 0);
+    for (int i = 0; has_targets && i < AGENT_COUNT; ++i) {
+        targets[i] = strtol(argv[optind+i], NULL, 0);
         if (targets[i] <= 0) {
             printf("Error: Each target must be a positive integer\n");
             return -1;
         }
     }
 
+    server_request_t options = {.mode = mode, .max_staleness = max_staleness, .pacing_us = pacing_us,
+        .seed = time(NULL)};
+    if (serve_path)
+        return run_server(serve_path, &options);
+    if (client_path)
+        return run_client(client_path, has_targets ? targets : NULL, &options, pacing_given);
+
+    if (join_address) {
+        if (run_shard(join_address) != 0) {
+            printf("Shard failed: %s\n", strerror(errno));
+            return -1;
+        }
+        printf("Shard exited.\n");
+        return 0;
+    }
+
+    if (n_shards > 0) {
+        shard_report_t report;
+        int status;
+        if (listen_address) {
+            int listen_fd = shard_listen(listen_address);
+            if (listen_fd == -1) {
+                printf("Listening on %s failed: %s\n", listen_address, strerror(errno));
+                return -1;
+            }
+            printf("Waiting for %d shards on %s\n", n_shards, listen_address);
+            fflush(stdout);
+
+            status = run_coordinator(listen_fd, n_shards, targets, &report);
+            close(listen_fd);
+        }
+        else {
+            status = run_distributed(n_shards, targets, &report);
+        }
+
+        if (status != 0) {
+            printf("Distributed run failed: %s\n", strerror(errno));
+            return -1;
+        }
+
+        int fixes = 0;
+        for (int i = 0; i < AGENT_COUNT; ++i)
+            fixes += report.result[i].fixes;
+        printf("All shards exited, agents fixed %d of %d broken cells.\n", fixes, report.total_broken);
+        return 0;
+    }
+
     // Create shared memory object
     int fd = shm_open(SHM_NAME,
             O_CREAT | O_RDWR,
@@ -62,23 +352,120 @@ int main(int argc, char *argv[]) {
 
     initialize_shared_mem(mem);
 
-    printf("total_broken=%d\n", mem->total_broken);
+    if (scenario_path) {
+        scenario_t scenario;
+        int scenario_targets[AGENT_COUNT];
+        if (scenario_open(&scenario, scenario_path) != 0) {
+            printf("Opening scenario %s failed: %s\n", scenario_path, strerror(errno));
+            return -1;
+        }
 
-    // Spawn child processes
-    for (int i = 0; i < AGENT_COUNT; ++i) {
-        pid_t pid = fork();
-        if (pid == 0)
-            return agent(mem, i, targets[i]);
+        int status = 0;
+        if (sparse_capacity > 0) {
+            sparse_grid_t *grid = sparse_create(scenario.header->rows, scenario.header->cols, sparse_capacity);
+            status = grid ? scenario_load_sparse(mem, grid, &scenario, scenario_targets) : -1;
+        }
+        else {
+            status = scenario_load(mem, &scenario, scenario_targets);
+        }
+
+        if (status != 0) {
+            printf("Loading scenario %s failed: %s\n", scenario_path, strerror(errno));
+            return -1;
+        }
+        scenario_close(&scenario);
+
+        if (!has_targets)
+            memcpy(targets, scenario_targets, sizeof(targets));
+    }
+
+    mem->mode = mode;
+    mem->max_staleness = max_staleness;
+    mem->pacing_us = pacing_us;
+
+    scenario_cells_t inject_list = {NULL, 0, 0};
+    if (inject_rate > 0) {
+        if (inject_path) {
+            if (load_inject_list(mem, inject_path, &inject_list) != 0) {
+                printf("Loading failures from %s failed: %s\n", inject_path, strerror(errno));
+                return -1;
+            }
+            inject_count = inject_list.count;
+        }
+
+        mem->inject = inject_create();
+        if (!mem->inject) {
+            printf("Creating the injection queue failed: %s\n", strerror(errno));
+            return -1;
+        }
     }
 
-    // This only runs in parent
+    if (use_coverage) {
+        mem->coverage = coverage_create(mem->bounds);
+        if (!mem->coverage) {
+            printf("Creating the coverage map failed: %s\n", strerror(errno));
+            return -1;
+        }
+    }
 
-    // Wait for all child processes to exit
-    for (int i = 0; i < AGENT_COUNT; ++i)
-        wait(NULL);
-    printf("All child processes exited.\n");
+    int total_broken = atomic_load(&mem->total_broken);
+    printf("total_broken=%d\n", total_broken);
+
+    // Publish live statistics for repairmen-top, the run goes on without them if that fails
+    mem->stats = stats_create(SHM_STATS_NAME, total_broken);
+    if (!mem->stats)
+        printf("Warning: Live statistics are disabled: %s\n", strerror(errno));
+
+    if (use_threads) {
+        // Spawn agent threads sharing the same mapping
+        harness_t harness;
+        if (harness_start_each(&harness, mem, targets) != 0) {
+            printf("pthread_create failed: %s\n", strerror(errno));
+            return -1;
+        }
+
+        if (mem->inject)
+            inject_run(mem, inject_list.cells, inject_count, inject_rate, time(NULL));
+
+        harness_join(&harness);
+        printf("All agent threads exited.\n");
+    }
+    else {
+        // Spawn child processes
+        for (int i = 0; i < AGENT_COUNT; ++i) {
+            pid_t pid = fork();
+            if (pid == 0)
+                return agent(mem, i, targets[i]);
+        }
+
+        // This only runs in parent
+
+        // Stream failures in while the agents run
+        if (mem->inject)
+            inject_run(mem, inject_list.cells, inject_count, inject_rate, time(NULL));
+
+        // Wait for all child processes to exit
+        for (int i = 0; i < AGENT_COUNT; ++i)
+            wait(NULL);
+        printf("All child processes exited.\n");
+    }
+
+    if (mem->inject) {
+        printf("total_broken=%d after injecting failures\n", atomic_load(&mem->total_broken));
+        inject_destroy(mem->inject);
+        free(inject_list.cells);
+    }
+
+    if (mem->coverage) {
+        printf("Agents visited %d of %d cells\n", coverage_count_visited(mem->coverage), mem->bounds[0] * mem->bounds[1]);
+        coverage_destroy(mem->coverage);
+    }
 
     // Cleanup and delete shared memory
+    if (mem->stats)
+        stats_destroy(mem->stats, SHM_STATS_NAME);
+    if (mem->sparse)
+        sparse_destroy(mem->sparse);
     cleanup_shared_mem(mem);
     munmap(mem, sizeof(shared_mem_t));
     shm_unlink(SHM_NAME);
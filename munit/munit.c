@@ -0,0 +1 @@
+/tmp/stub/munit/munit.c
\ No newline at end of file
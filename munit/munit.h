@@ -0,0 +1 @@
+/tmp/stub/munit/munit.h
\ No newline at end of file
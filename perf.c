@@ -0,0 +1,104 @@
+/**
+ * @file perf.c
+ * @brief Implementation for reading performance counters of agents and benchmarks
+ */
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <semaphore.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "perf.h"
+
+const char *const PERF_COUNTER_NAMES[PERF_COUNTER_COUNT] = {
+    "cycles", "instructions", "llc_misses", "context_switches", "futex_waits"
+};
+
+/** perf_event_open type and config of each kernel counter, in perf_counter_t order */
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} EVENTS[PERF_FUTEX_WAITS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+/** Blocked waits of the calling thread */
+static _Thread_local uint64_t futex_waits = 0;
+
+int perf_open(perf_counters_t *counters, bool inherit) {
+    int opened = 0;
+
+    for (int i = 0; i < PERF_FUTEX_WAITS; ++i) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = EVENTS[i].type;
+        attr.config = EVENTS[i].config;
+        attr.inherit = inherit;
+
+        // Unprivileged users may only count user space with perf_event_paranoid at 2, but context
+        // switches happen in the kernel and are counted per task anyway
+        attr.exclude_kernel = EVENTS[i].type == PERF_TYPE_HARDWARE;
+        attr.exclude_hv = 1;
+
+        counters->fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        opened += counters->fd[i] != -1;
+    }
+    counters->fd[PERF_FUTEX_WAITS] = -1;
+    counters->futex_waits = futex_waits;
+
+    return opened;
+}
+
+void perf_read(const perf_counters_t *counters, uint64_t values[PERF_COUNTER_COUNT]) {
+    for (int i = 0; i < PERF_FUTEX_WAITS; ++i) {
+        uint64_t value;
+        if (counters->fd[i] == -1 || read(counters->fd[i], &value, sizeof(value)) != sizeof(value))
+            value = PERF_UNAVAILABLE;
+        values[i] = value;
+    }
+    values[PERF_FUTEX_WAITS] = futex_waits - counters->futex_waits;
+}
+
+void perf_close(perf_counters_t *counters) {
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (counters->fd[i] != -1)
+            close(counters->fd[i]);
+        counters->fd[i] = -1;
+    }
+}
+
+void perf_count_futex_wait(void) {
+    futex_waits ++;
+}
+
+perf_results_t *perf_results_create(void) {
+    perf_results_t *results = mmap(NULL, sizeof(perf_results_t), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED)
+        return NULL;
+
+    perf_results_reset(results);
+    return results;
+}
+
+void perf_results_reset(perf_results_t *results) {
+    for (int i = 0; i < AGENT_COUNT; ++i)
+        for (int c = 0; c < PERF_COUNTER_COUNT; ++c)
+            results->agent[i][c] = PERF_UNAVAILABLE;
+}
+
+void perf_results_destroy(perf_results_t *results) {
+    munmap(results, sizeof(perf_results_t));
+}
@@ -0,0 +1,93 @@
+/**
+ * @file perf.h
+ * @brief Public interface for reading performance counters of agents and benchmarks
+ */
+
+#ifndef PERF_H_
+#define PERF_H_
+
+/** Counters read for each agent or benchmark repetition */
+typedef enum {
+    PERF_CYCLES,            ///< CPU cycles spent in user space
+    PERF_INSTRUCTIONS,      ///< Instructions retired in user space
+    PERF_LLC_MISSES,        ///< Last level cache misses
+    PERF_CONTEXT_SWITCHES,  ///< Context switches
+    PERF_FUTEX_WAITS,       ///< Barrier waits that had to block, each of them a futex wait syscall
+    PERF_COUNTER_COUNT
+} perf_counter_t;
+
+/** Value of a counter that isn't available, e.g. without a hardware PMU or when perf_event_paranoid forbids it */
+#define PERF_UNAVAILABLE UINT64_MAX
+
+/** Name of each counter, in perf_counter_t order */
+extern const char *const PERF_COUNTER_NAMES[PERF_COUNTER_COUNT];
+
+/** Counters opened on a thread */
+typedef struct {
+    int fd[PERF_COUNTER_COUNT];     ///< perf_event_open descriptor of each kernel counter, or -1 if unavailable
+    uint64_t futex_waits;           ///< Blocked waits the thread had done when the counters were opened
+} perf_counters_t;
+
+/** Counters of each agent, in memory shared with child processes */
+struct perf_results {
+    uint64_t agent[AGENT_COUNT][PERF_COUNTER_COUNT];    ///< Counters of each agent's run, PERF_UNAVAILABLE where missing
+};
+
+/**
+ * @brief Start counting on the calling thread
+ *
+ * Counters the kernel refuses are left unavailable, so this never fails. Blocked waits are counted
+ * by the agents themselves, since reading futex syscalls needs tracepoints unprivileged users can't open.
+ *
+ * @param[out] counters Counters to start
+ * @param[in] inherit   Also count threads and child processes created from now on, except for
+ *                      blocked waits which only count the calling thread
+ *
+ * @return Number of kernel counters that could be opened
+ */
+int perf_open(perf_counters_t *counters, bool inherit);
+
+/**
+ * @brief Read the counters since they were opened
+ *
+ * Counts of inherited threads and processes are included once they have exited.
+ *
+ * @param[in] counters  Counters opened with perf_open
+ * @param[out] values   Value of each counter, or PERF_UNAVAILABLE
+ */
+void perf_read(const perf_counters_t *counters, uint64_t values[PERF_COUNTER_COUNT]);
+
+/**
+ * @brief Stop counting and release the counters
+ *
+ * @param[in] counters  Counters opened with perf_open
+ */
+void perf_close(perf_counters_t *counters);
+
+/**
+ * @brief Count a barrier wait of the calling thread that had to block
+ */
+void perf_count_futex_wait(void);
+
+/**
+ * @brief Create per agent results in memory shared with child processes
+ *
+ * @return Pointer to the results with every counter unavailable, otherwise returns NULL and sets errno to indicate error
+ */
+perf_results_t *perf_results_create(void);
+
+/**
+ * @brief Mark every counter unavailable before another run, must not be called while agents use the results
+ *
+ * @param[in] results   Pointer to the results
+ */
+void perf_results_reset(perf_results_t *results);
+
+/**
+ * @brief Free results created with perf_results_create
+ *
+ * @param[in] results   Pointer to the results
+ */
+void perf_results_destroy(perf_results_t *results);
+
+#endif // PERF_H_
@@ -4,6 +4,7 @@
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <semaphore.h>
+#include <sched.h>
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -11,24 +12,63 @@
 #include <time.h>
 #include <errno.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdatomic.h>
 
 #include "barrier.h"
 #include "repairmen.h"
+#include "sparse.h"
+#include "kernels.h"
+#include "agents.h"
+#include "stats.h"
+#include "inject.h"
+#include "coverage.h"
+#include "perf.h"
+
+/**
+ * Apply injected failures and update the coverage map while every agent is blocked on the done barrier
+ */
+static void drain_round(void *arg) {
+    shared_mem_t *mem = arg;
+    inject_drain(mem);
+    coverage_update(mem->coverage);
+}
 
 int initialize_shared_mem(shared_mem_t *mem) {
     int status = 0;
 
-    mem->total_broken = 0;
+    int total_broken = 0;
     for (int i = 0; i < GRID_SIZE; ++i)
         for (int j = 0; j < GRID_SIZE; ++j) {
             // Set fixed status for grid cells at random
             bool broken = (bool) (rand() % 2);
-            mem->grid[i][j].fixed = !broken;
-            mem->total_broken += broken;
-
-            for (int k = 0; k < AGENT_COUNT; ++k)
-                mem->grid[i][j].log[k] = 0;
+            cell_init(&mem->grid[i][j], !broken);
+            total_broken += broken;
         }
+    atomic_init(&mem->total_broken, total_broken);
+
+    // Each agent starts out standing on its own corner
+    initialize_starting_pos(mem->start);
+    for (int k = 0; k < AGENT_COUNT; ++k) {
+        atomic_init(&mem->grid[mem->start[k][0]][mem->start[k][1]].occupant, k);
+        atomic_init(&mem->step[k], 0);
+    }
+    atomic_init(&mem->drained_step, 0);
+
+    mem->sparse = NULL;
+    mem->bounds[0] = GRID_SIZE;
+    mem->bounds[1] = GRID_SIZE;
+
+    mem->mode = MODE_LOCKSTEP;
+    mem->max_staleness = 0;
+    mem->pacing_us = PACING_US;
+    memset(mem->result, 0, sizeof(mem->result));
+    atomic_init(&mem->running, AGENT_COUNT);
+    mem->stats = NULL;
+    mem->inject = NULL;
+    mem->coverage = NULL;
+    mem->perf = NULL;
 
     status = barrier_init(&mem->ready_barrier, AGENT_COUNT);
     if (status != 0)
@@ -37,10 +77,55 @@ int initialize_shared_mem(shared_mem_t *mem) {
     status = barrier_init(&mem->done_barrier, AGENT_COUNT);
     if (status != 0)
         return status;
+    barrier_set_hook(&mem->done_barrier, drain_round, mem);
 
     return 0;
 }
 
+int reset_shared_mem(shared_mem_t *mem, unsigned seed) {
+    int status = 0;
+
+    // Flags, logs and sequences all start out as zero, so the whole grid is cleared at once
+    memset(mem->grid, 0, sizeof(mem->grid));
+
+    // Each rand_r call gives at least 15 random bits, one per cell
+    cell_t *cells = &mem->grid[0][0];
+    int total_broken = 0, n_bits = 0;
+    unsigned bits = 0;
+    for (int i = 0; i < GRID_SIZE * GRID_SIZE; ++i) {
+        if (n_bits == 0) {
+            bits = rand_r(&seed);
+            n_bits = 15;
+        }
+        bool broken = bits & 1;
+        bits >>= 1;
+        n_bits --;
+
+        atomic_init(&cells[i].fixed, !broken);
+        atomic_init(&cells[i].occupant, CELL_EMPTY);
+        total_broken += broken;
+    }
+    atomic_store_explicit(&mem->total_broken, total_broken, memory_order_relaxed);
+
+    initialize_starting_pos(mem->start);
+    for (int k = 0; k < AGENT_COUNT; ++k) {
+        atomic_store_explicit(&mem->grid[mem->start[k][0]][mem->start[k][1]].occupant, k, memory_order_relaxed);
+        atomic_store_explicit(&mem->step[k], 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&mem->drained_step, 0, memory_order_relaxed);
+
+    memset(mem->result, 0, sizeof(mem->result));
+    atomic_store_explicit(&mem->running, AGENT_COUNT, memory_order_release);
+    if (mem->coverage)
+        coverage_reset(mem->coverage);
+
+    status = barrier_reset(&mem->ready_barrier, AGENT_COUNT);
+    if (status != 0)
+        return status;
+
+    return barrier_reset(&mem->done_barrier, AGENT_COUNT);
+}
+
 void cleanup_shared_mem(shared_mem_t *mem) {
     barrier_cleanup(&mem->ready_barrier);
     barrier_cleanup(&mem->done_barrier);
@@ -58,20 +143,31 @@ bool is_pos_equal(int first[2], int second[2]) {
 }
 
 void apply_move(int pos[2], int direction, int new_pos[2]) {
+    static const int bounds[2] = {GRID_SIZE, GRID_SIZE};
+    apply_move_bounded(pos, direction, bounds, new_pos);
+}
+
+void apply_move_bounded(int pos[2], int direction, const int bounds[2], int new_pos[2]) {
     new_pos[0] = pos[0] + MOVE_DELTA[direction][0],
     new_pos[1] = pos[1] + MOVE_DELTA[direction][1];
 
     // Reverse the direction if we go out of the bounds
     if (new_pos[0] < 0)
         new_pos[0] += 2;
-    if (GRID_SIZE - 1 < new_pos[0])
+    if (bounds[0] - 1 < new_pos[0])
         new_pos[0] -= 2;
     if (new_pos[1] < 0)
         new_pos[1] += 2;
-    if (GRID_SIZE - 1 < new_pos[1])
+    if (bounds[1] - 1 < new_pos[1])
         new_pos[1] -= 2;
 }
 
+cell_t *grid_cell(shared_mem_t *mem, int pos[2]) {
+    if (mem->sparse)
+        return sparse_get(mem->sparse, pos);
+    return &mem->grid[pos[0]][pos[1]];
+}
+
 void update_positions(int pos[][2], action_t action[], int dest[][2]) {
     /**
      * To break ties and avoiding deadlocks, a priority system is implemented.
@@ -136,48 +232,129 @@ void update_positions(int pos[][2], action_t action[], int dest[][2]) {
     }
 }
 
-int agent(shared_mem_t *mem, int id, int target) {
-    // Stores number of moves this agent has made
-    int n_moves = 0;
+/**
+ * choose_action with the log merge and exit check done by a step kernel, heading for unexplored
+ * cells when a coverage map is given
+ */
+static action_t choose_action_kernel(const kernel_t *kernel, const coverage_t *coverage, cell_t *cell, int id,
+        int target, int total_broken, int pos[2], int fixed[], int *dir) {
+    *dir = 0;
+
+    int log[AGENT_COUNT];
+    cell_log_read(cell, log);
+    kernel->merge_log(fixed, log, AGENT_COUNT);
+
+    // Check exit condition
+    if (kernel->should_exit(fixed, AGENT_COUNT, id, target, total_broken))
+        return ACT_DIE;
+
+    if (cell->fixed) {
+        // Choose direction at random, unless the map knows of somewhere left to explore
+        *dir = coverage ? coverage_best_dir(coverage, pos) : -1;
+        if (*dir < 0)
+            *dir = rand() % DIRECTION_COUNT;
+        return ACT_MOVE;
+    }
+
+    // Cell needs to be fixed
+    return ACT_REPAIR;
+}
+
+action_t choose_action(const kernel_t *kernel, cell_t *cell, int id, int target, int total_broken,
+        int pos[2], int fixed[], int *dir) {
+    return choose_action_kernel(kernel, NULL, cell, id, target, total_broken, pos, fixed, dir);
+}
+
+/**
+ * Record the summary of an agent's run and report it
+ */
+static void finish_agent(shared_mem_t *mem, int id, int steps, int moves, int fixes) {
+    mem->result[id] = (agent_result_t) {steps, moves, fixes};
+    stats_record_step(mem->stats, id, steps, moves, fixes);
+    stats_record_exit(mem->stats, id);
+    atomic_fetch_sub_explicit(&mem->running, 1, memory_order_release);
+    printf("Agent %d exited with %d moves and %d fixes\n", id+1, moves, fixes);
+}
+
+/**
+ * Simulate agents moving at different speeds
+ */
+static void pace_agent(shared_mem_t *mem, int id) {
+    if (mem->pacing_us > 0)
+        usleep((id+1) * mem->pacing_us);
+}
+
+/**
+ * Returns the number of cells agents may exit after seeing fixed
+ *
+ * While failures are still being injected the final number isn't known, so it can't be reached.
+ */
+static int known_total_broken(shared_mem_t *mem) {
+    if (!inject_finished(mem->inject))
+        return INT_MAX;
+    return atomic_load_explicit(&mem->total_broken, memory_order_relaxed);
+}
 
-    // Stores x,y position for each process
-    int pos[AGENT_COUNT][2];
-    initialize_starting_pos(pos);
+/**
+ * Wait on a barrier, adding the time spent to the agent's statistics
+ */
+static void wait_for_all(shared_mem_t *mem, int id, barrier_t *barrier) {
+    // Only waits that can't pass right away block in the kernel
+    if (barrier_try_wait(barrier) == 0)
+        return;
+    perf_count_futex_wait();
+
+    if (!mem->stats) {
+        barrier_wait_for_all(barrier);
+        return;
+    }
+
+    uint64_t start = stats_now_ns();
+    barrier_wait_for_all(barrier);
+    stats_record_wait(mem->stats, id, stats_now_ns() - start);
+}
+
+static int lockstep_agent(shared_mem_t *mem, int id, int target) {
+    // Stores number of moves and steps this agent has made
+    int n_moves = 0, n_steps = 0;
+
+    // Every agent keeps the positions of all agents and moves them all at the end of each round
+    agents_t agents;
+    if (agents_create(&agents, AGENT_COUNT) != 0) {
+        printf("Agent %d can't track the other agents: %s\n", id+1, strerror(errno));
+        mem->action[id] = ACT_DIE;
+        finish_agent(mem, id, n_steps, n_moves, 0);
+        barrier_signal_exit(&mem->ready_barrier);
+        barrier_signal_exit(&mem->done_barrier);
+        return -1;
+    }
+    for (int i = 0; i < AGENT_COUNT; ++i) {
+        agents.x[i] = mem->start[i][0];
+        agents.y[i] = mem->start[i][1];
+    }
 
     int fixed[AGENT_COUNT] = {0};
 
-    while (true) {
-        // Pointer to the cell we're currently in
-        cell_t *cell = &mem->grid[pos[id][0]][pos[id][1]];
+    // The grid can't change size during a run, so the kernel is picked once
+    const kernel_t *kernel = kernel_select(AGENT_COUNT, mem->bounds);
 
-        for (int i = 0; i < AGENT_COUNT; ++i)
-            if (fixed[i] < cell->log[i])
-                fixed[i] = cell->log[i];
+    while (true) {
+        int pos[2] = {agents.x[id], agents.y[id]};
 
-        // Check exit condition
-        int total_fixed = 0;
-        for (int i = 0; i < AGENT_COUNT; ++i)
-            total_fixed += fixed[i];
-        if (fixed[id] == target || total_fixed == mem->total_broken) {
+        // Pointer to the cell we're currently in
+        cell_t *cell = grid_cell(mem, pos);
+        if (!cell) {
+            printf("Agent %d can't track more cells: %s\n", id+1, strerror(errno));
             mem->action[id] = ACT_DIE;
+            mem->dir[id] = 0;
         }
-        else if (cell->fixed) {
-            // Choose direction at random
-            int new_pos[2];
-            apply_move(pos[id], rand() % DIRECTION_COUNT, new_pos);
-
-            mem->action[id] = ACT_MOVE;
-            mem->dest[id][0] = new_pos[0];
-            mem->dest[id][1] = new_pos[1];
-        }
-        else { // Cell needs to be fixed
-            mem->action[id] = ACT_REPAIR;
-            mem->dest[id][0] = pos[id][0];
-            mem->dest[id][1] = pos[id][1];
+        else {
+            mem->action[id] = choose_action_kernel(kernel, mem->coverage, cell, id, target, known_total_broken(mem),
+                    pos, fixed, &mem->dir[id]);
         }
 
         if (mem->action[id] == ACT_DIE) {
-            printf("Agent %d exited with %d moves and %d fixes\n", id+1, n_moves, fixed[id]);
+            finish_agent(mem, id, n_steps, n_moves, fixed[id]);
             barrier_signal_exit(&mem->ready_barrier);
             barrier_signal_exit(&mem->done_barrier);
             break;
@@ -187,27 +364,164 @@ int agent(shared_mem_t *mem, int id, int target) {
         }
 
         // Signal proposed move and wait for all agents to decide on their next action
-        barrier_wait_for_all(&mem->ready_barrier);
+        wait_for_all(mem, id, &mem->ready_barrier);
+
+        // Turn every proposed direction into a destination at once
+        memcpy(agents.action, mem->action, sizeof(mem->action));
+        memcpy(agents.dir, mem->dir, sizeof(mem->dir));
+        agents_propose(&agents, mem->bounds);
 
         if (mem->action[id] == ACT_REPAIR) {
-            cell->fixed = true;
+            if (cell_claim_repair(cell))
+                stats_record_fix(mem->stats);
             fixed[id] ++;
         }
-        else if (!is_pos_equal(pos[id], mem->dest[id])) {
+        else if (agents.dest_x[id] != pos[0] || agents.dest_y[id] != pos[1]) {
             n_moves ++;
         }
-        cell->log[id] = fixed[id];
-        update_positions(pos, mem->action, mem->dest);
+        coverage_visit(mem->coverage, pos);
+        cell_log_write(cell, id, fixed[id]);
+        agents_update_positions(&agents);
 
-        //printf("Agent %d moves=%d fixed=%d pos=(%d,%d)\n", id, n_moves, fixed[id], pos[id][0], pos[id][1]);
+        //printf("Agent %d moves=%d fixed=%d pos=(%d,%d)\n", id, n_moves, fixed[id], agents.x[id], agents.y[id]);
 
         // Signal end of move and wait for all agents to do their move
         barrier_signal_ready(&mem->done_barrier);
-        barrier_wait_for_all(&mem->done_barrier);
+        wait_for_all(mem, id, &mem->done_barrier);
+
+        n_steps ++;
+        stats_record_step(mem->stats, id, n_steps, n_moves, fixed[id]);
+        pace_agent(mem, id);
+    }
+
+    agents_destroy(&agents);
+    return 0;
+}
+
+
+/**
+ * Returns the step counter of the slowest agent that is still running
+ */
+static int slowest_step(shared_mem_t *mem) {
+    int slowest = INT_MAX;
+    for (int i = 0; i < AGENT_COUNT; ++i) {
+        int step = atomic_load_explicit(&mem->step[i], memory_order_acquire);
+        if (step < slowest)
+            slowest = step;
+    }
+    return slowest;
+}
+
+/**
+ * Without barriers, the first agent to see the slowest agent finish a step applies the failures
+ * injected since and updates the coverage map, so that's done once per round like in lockstep
+ */
+static void drain_relaxed_round(shared_mem_t *mem) {
+    int slowest = slowest_step(mem);
+    int drained = atomic_load_explicit(&mem->drained_step, memory_order_relaxed);
+    if (slowest > drained &&
+            atomic_compare_exchange_strong_explicit(&mem->drained_step, &drained, slowest,
+                memory_order_acq_rel, memory_order_relaxed)) {
+        inject_drain(mem);
+        coverage_update(mem->coverage);
+    }
+}
+
+static int relaxed_agent(shared_mem_t *mem, int id, int target) {
+    // Stores number of moves and steps this agent has made
+    int n_moves = 0, n_steps = 0;
+
+    // Only our own position is known, other agents are seen through cell occupants
+    int pos[2] = {mem->start[id][0], mem->start[id][1]};
+
+    int fixed[AGENT_COUNT] = {0};
+
+    const kernel_t *kernel = kernel_select(AGENT_COUNT, mem->bounds);
+
+    while (true) {
+        /**
+         * We own the cell we're standing on, so no other agent reads or writes it until we release it.
+         * Releasing the cell publishes our repair and log to the next occupant.
+         */
+        cell_t *cell = grid_cell(mem, pos);
+        if (!cell) {
+            printf("Agent %d can't track more cells: %s\n", id+1, strerror(errno));
+            finish_agent(mem, id, n_steps, n_moves, fixed[id]);
+            atomic_store_explicit(&mem->step[id], INT_MAX, memory_order_release);
+            break;
+        }
+
+        int dir, dest[2];
+        action_t action = choose_action_kernel(kernel, mem->coverage, cell, id, target, known_total_broken(mem),
+                pos, fixed, &dir);
+        kernel->apply_move(pos, dir, mem->bounds, dest);
+
+        if (action == ACT_DIE) {
+            finish_agent(mem, id, n_steps, n_moves, fixed[id]);
+            cell_release(cell);
+            atomic_store_explicit(&mem->step[id], INT_MAX, memory_order_release);
+            break;
+        }
+
+        if (action == ACT_REPAIR && cell_claim_repair(cell)) {
+            stats_record_fix(mem->stats);
+            fixed[id] ++;
+        }
+        coverage_visit(mem->coverage, pos);
+        cell_log_write(cell, id, fixed[id]);
+
+        // Stay put if someone else holds the destination
+        cell_t *dest_cell = NULL;
+        if (action == ACT_MOVE && !is_pos_equal(pos, dest)) {
+            dest_cell = grid_cell(mem, dest);
+            if (!dest_cell) {
+                printf("Agent %d can't track more cells: %s\n", id+1, strerror(errno));
+                finish_agent(mem, id, n_steps, n_moves, fixed[id]);
+                cell_release(cell);
+                atomic_store_explicit(&mem->step[id], INT_MAX, memory_order_release);
+                break;
+            }
+        }
+        if (dest_cell && cell_try_occupy(dest_cell, id)) {
+            cell_release(cell);
+            pos[0] = dest[0];
+            pos[1] = dest[1];
+            n_moves ++;
+        }
 
-        usleep((id+1) * 10 * 1000);
+        // Publish our progress and wait while we're too far ahead of the slowest agent
+        n_steps ++;
+        atomic_store_explicit(&mem->step[id], n_steps, memory_order_release);
+        drain_relaxed_round(mem);
+        stats_record_step(mem->stats, id, n_steps, n_moves, fixed[id]);
+        if (n_steps - slowest_step(mem) > mem->max_staleness) {
+            uint64_t start = mem->stats ? stats_now_ns() : 0;
+            while (n_steps - slowest_step(mem) > mem->max_staleness)
+                sched_yield();
+            if (mem->stats)
+                stats_record_wait(mem->stats, id, stats_now_ns() - start);
+        }
+
+        pace_agent(mem, id);
     }
 
     return 0;
 }
 
+int agent(shared_mem_t *mem, int id, int target) {
+    perf_counters_t counters;
+    if (mem->perf)
+        perf_open(&counters, false);
+
+    int status;
+    if (mem->mode == MODE_RELAXED)
+        status = relaxed_agent(mem, id, target);
+    else
+        status = lockstep_agent(mem, id, target);
+
+    if (mem->perf) {
+        perf_read(&counters, mem->perf->agent[id]);
+        perf_close(&counters);
+    }
+    return status;
+}
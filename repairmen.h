@@ -9,12 +9,17 @@
 /** Number of repairmen processes */
 #define AGENT_COUNT 4
 
-/** Width and height of the network grid */
+/** Width and height of the network grid, can be overridden at build time for larger grids */
+#ifndef GRID_SIZE
 #define GRID_SIZE 7
+#endif
 
 /** Number of available directions for a move */
 #define DIRECTION_COUNT 5
 
+/** Default delay between steps of the first agent in microseconds, agent i waits (i+1) times as long */
+#define PACING_US (10 * 1000)
+
 /** Name of the shared memory file in kernel filesystem */
 #define SHM_NAME "/repairmen"
 
@@ -35,6 +40,12 @@ static const int STARTING_POS[AGENT_COUNT][2] = {
     {GRID_SIZE-1, GRID_SIZE-1}
 };
 
+/** Execution models for stepping agents through the simulation */
+typedef enum {
+    MODE_LOCKSTEP,  ///< All agents advance together, synchronized by two barriers per step
+    MODE_RELAXED    ///< Agents advance independently and may run up to max_staleness steps ahead of the slowest agent
+} exec_mode_t;
+
 /** Actions available to agents at each step */
 typedef enum {
     ACT_MOVE,
@@ -42,29 +53,85 @@ typedef enum {
     ACT_DIE
 } action_t;
 
-/** A single cell in the grid */
+/** Summary of an agent's run, written when it exits */
+typedef struct {
+    int steps;  ///< Number of steps the agent has done
+    int moves;  ///< Number of moves the agent has made
+    int fixes;  ///< Number of cells the agent has fixed
+} agent_result_t;
+
+/** Occupant value of a cell that no agent is standing on */
+#define CELL_EMPTY (-1)
+
+/**
+ * A single cell in the grid
+ *
+ * All fields are atomic so cells can be shared between agents without a barrier. The occupant word
+ * gives one agent at a time ownership of the cell, repairs are claimed by compare-and-swap on fixed,
+ * and log is guarded by a seqlock so readers always see a snapshot taken between two writes.
+ */
 typedef struct {
-    bool fixed;             ///< True if this cell is fixed, false if it needs to be repaired
-    int log[AGENT_COUNT];   ///< Last recorded number of cells each agent has fixed when visiting this cell
+    atomic_bool fixed;              ///< True if this cell is fixed, false if it needs to be repaired
+    atomic_int log[AGENT_COUNT];    ///< Last recorded number of cells each agent has fixed when visiting this cell
+    atomic_uint log_seq;            ///< Seqlock sequence for log, odd while a write is in progress
+    atomic_int occupant;            ///< Id of the agent standing on this cell in relaxed mode, or CELL_EMPTY
 } cell_t;
 
+/** Sparse grid of cells, defined in sparse.h */
+typedef struct sparse_grid sparse_grid_t;
+
+/** Live statistics of a run, defined in stats.h */
+typedef struct stats stats_t;
+
+/** Queue of failures injected into a running simulation, defined in inject.h */
+typedef struct inject_queue inject_queue_t;
+
+/** Shared map of explored cells, defined in coverage.h */
+typedef struct coverage coverage_t;
+
+/** Performance counters of each agent, defined in perf.h */
+typedef struct perf_results perf_results_t;
+
+/** Step kernel for a number of agents and grid size, defined in kernels.h */
+typedef struct kernel kernel_t;
+
 /** Data shared between agents */
 typedef struct {
     cell_t grid[GRID_SIZE][GRID_SIZE];  ///< The network cells
-    int total_broken;                   ///< Total number of cells that need to be fixed in the grid
+    sparse_grid_t *sparse;              ///< Sparse grid used instead of grid when not NULL
+    int bounds[2];                      ///< Number of rows and columns in the grid in use
+    atomic_int total_broken;            ///< Total number of cells that need to be fixed in the grid, grows as failures are injected
+    int start[AGENT_COUNT][2];          ///< Starting (x,y) position of each agent
 
     action_t action[AGENT_COUNT];   ///< Proposed action for each agent
-    int dest[AGENT_COUNT][2];       ///< Proposed destination (x,y) pair for each agent
+    int dir[AGENT_COUNT];           ///< Proposed direction of each agent as an index in MOVE_DELTA, 0 unless moving
 
     barrier_t ready_barrier;    ///< Synchronization barrier for when all agents have proposed their next move
     barrier_t done_barrier;     ///< Synchronization barrier for when all agents have done their move
+
+    exec_mode_t mode;               ///< Execution model used by agents
+    int max_staleness;              ///< Number of steps an agent may run ahead of the slowest agent in relaxed mode
+    atomic_int step[AGENT_COUNT];   ///< Number of steps each agent has done in relaxed mode, INT_MAX once it has exited
+    atomic_int drained_step;        ///< Slowest step at which a relaxed agent last drained failures and updated the coverage map
+    int pacing_us;                  ///< Delay between steps of the first agent, agent i waits (i+1) times as long. 0 disables pacing
+
+    agent_result_t result[AGENT_COUNT]; ///< Summary of each agent's run, valid once it has exited
+    atomic_int running;                 ///< Number of agents that haven't exited yet
+    stats_t *stats;                     ///< Live statistics updated by agents, or NULL if not monitored
+    inject_queue_t *inject;             ///< Failures to break at round boundaries, or NULL if the grid only gets fixed
+    coverage_t *coverage;               ///< Map of explored cells agents move towards the unexplored ones by, or NULL for random moves
+    perf_results_t *perf;               ///< Performance counters each agent fills in when it exits, or NULL if not measured
 } shared_mem_t;
 
 /**
  * @brief Initialize shared memory for the simulation
  *
  * Sets up the grid with random number of broken and fixed cells, and initializes 
- * synchronization mechanisms for agents.
+ * synchronization mechanisms for agents. Execution mode defaults to MODE_LOCKSTEP,
+ * agents are paced by PACING_US, agents start on the corners in STARTING_POS, and each agent's starting cell is marked
+ * as occupied by it. The dense grid is used until a sparse grid is attached, and no statistics
+ * are kept until a segment is attached to mem->stats. Failures queued on mem->inject are
+ * applied and the distance field of mem->coverage is updated when all agents reach the done barrier.
  *
  * @param[in] mem   Pointer to the shared memory structure
  *
@@ -73,6 +140,22 @@ typedef struct {
  */
 int initialize_shared_mem(shared_mem_t *mem);
 
+/**
+ * @brief Reset shared memory initialized with initialize_shared_mem for another run
+ *
+ * Clears the dense grid in bulk and breaks cells using bits drawn from seed, so the same seed always
+ * gives the same grid. Starting positions, step counters, results, both barriers and the coverage
+ * map are reset, while the execution mode, pacing, statistics and injection queue are kept. Must only be
+ * called once every agent of the previous run has exited.
+ *
+ * @param[in] mem   Pointer to the shared memory structure
+ * @param[in] seed  Seed for picking the broken cells
+ *
+ * @retval 0        Reset is successfully done
+ * @retval other    Some error occured. Sets errno to indicate error
+ */
+int reset_shared_mem(shared_mem_t *mem, unsigned seed);
+
 /**
  * @brief Cleanup the shared memory
  *
@@ -86,6 +169,15 @@ void cleanup_shared_mem(shared_mem_t *mem);
  * The agent attempts to repair cells in the grid and moves around based on the simulation rules.
  * When the agent reaches its target repairs or deduces there are no more cells left to repair it returns.
  *
+ * Agents don't exit for lack of broken cells while failures are still being injected. With a
+ * coverage map attached, agents on a fixed cell move towards the closest cell not known to be fixed
+ * instead of at random. With mem->perf attached, the agent counts its own run and stores the counters
+ * when it exits.
+ *
+ * In MODE_LOCKSTEP all agents propose an action, wait on a barrier, apply it and wait again.
+ * In MODE_RELAXED each agent claims its destination cell with a compare-and-swap on the cell
+ * occupant, and only waits when it is more than mem->max_staleness steps ahead of the slowest agent.
+ *
  * @param[in] mem       Pointer to the initialized memory structure shared between agents
  * @param[in] id        Unique identifier for this agent. Must be in range 0 <= id < AGENT_COUNT
  * @param[in] target    Number of cells this agent aims to repair before exiting
@@ -94,6 +186,93 @@ void cleanup_shared_mem(shared_mem_t *mem);
  */
 int agent(shared_mem_t *mem, int id, int target);
 
+/**
+ * @brief Decide the next action of an agent standing on a cell
+ *
+ * Merges the cell log into the agent's knowledge, checks the exit condition, and picks
+ * a repair if the cell is broken or a random move otherwise.
+ *
+ * @param[in] kernel        Step kernel for AGENT_COUNT agents and the grid size, from kernel_select
+ * @param[in] cell          Pointer to the cell the agent is standing on
+ * @param[in] id            Id of the agent
+ * @param[in] target        Number of cells the agent aims to repair before exiting
+ * @param[in] total_broken  Total number of cells that need to be fixed in the grid
+ * @param[in] pos           Current (x,y) position of the agent
+ * @param[in,out] fixed     Number of cells the agent knows each agent has fixed
+ * @param[out] dir          Proposed direction as an index in MOVE_DELTA, 0 unless moving
+ *
+ * @return ACT_DIE when the agent should exit, otherwise the proposed action
+ */
+action_t choose_action(const kernel_t *kernel, cell_t *cell, int id, int target, int total_broken,
+        int pos[2], int fixed[], int *dir);
+
+/**
+ * @brief Get the cell at a position of the grid in use
+ *
+ * @param[in] mem   Pointer to the shared memory structure
+ * @param[in] pos   (x,y) position of the cell
+ *
+ * @return Pointer to the cell, or NULL if a sparse grid is in use and it's full
+ */
+cell_t *grid_cell(shared_mem_t *mem, int pos[2]);
+
+/**
+ * @brief Initialize a cell with an empty log and no occupant
+ *
+ * Must not be called while other agents may access the cell.
+ *
+ * @param[out] cell     Pointer to the cell
+ * @param[in] fixed     Initial fixed status of the cell
+ */
+void cell_init(cell_t *cell, bool fixed);
+
+/**
+ * @brief Try to become the occupant of an empty cell
+ *
+ * On success all writes made by the previous occupant before it released the cell are visible.
+ *
+ * @param[in] cell  Pointer to the cell
+ * @param[in] id    Id of the agent trying to enter the cell
+ *
+ * @return true if the cell was empty and is now occupied by id, false otherwise
+ */
+bool cell_try_occupy(cell_t *cell, int id);
+
+/**
+ * @brief Leave a cell previously occupied with cell_try_occupy
+ *
+ * @param[in] cell  Pointer to the cell
+ */
+void cell_release(cell_t *cell);
+
+/**
+ * @brief Claim the repair of a broken cell
+ *
+ * Exactly one of any number of concurrent callers on a broken cell wins the claim.
+ *
+ * @param[in] cell  Pointer to the cell
+ *
+ * @return true if the cell was broken and the caller has fixed it, false if it was already fixed
+ */
+bool cell_claim_repair(cell_t *cell);
+
+/**
+ * @brief Record the number of cells an agent has fixed in the cell log
+ *
+ * @param[in] cell  Pointer to the cell
+ * @param[in] id    Id of the agent whose log entry is written
+ * @param[in] value Number of cells the agent has fixed
+ */
+void cell_log_write(cell_t *cell, int id, int value);
+
+/**
+ * @brief Take a consistent snapshot of the cell log
+ *
+ * @param[in] cell  Pointer to the cell
+ * @param[out] log  Array receiving one log entry per agent
+ */
+void cell_log_read(cell_t *cell, int log[AGENT_COUNT]);
+
 /**
  * @brief Check equality between two (x,y) pairs
  */
@@ -115,6 +294,16 @@ void initialize_starting_pos(int pos[][2]);
  */
 void apply_move(int pos[2], int dir, int new_pos[2]);
 
+/**
+ * @brief Apply a directional move on a position in a grid of any size
+ *
+ * @param[in] pos       Current (x,y) position
+ * @param[in] dir       Index for direction of move in MOVE_DELTA array
+ * @param[in] bounds    Number of rows and columns in the grid
+ * @param[out] new_pos  Pointer to array containing new position after move
+ */
+void apply_move_bounded(int pos[2], int dir, const int bounds[2], int new_pos[2]);
+
 /**
  * @brief Update all agents positions without overlapping simultaneously
  *
@@ -0,0 +1,136 @@
+/**
+ * @file repairmen_top.c
+ * @brief Shows live statistics of a running simulation
+ *
+ * The statistics segment is mapped read-only and only read with relaxed loads, so watching a
+ * run never takes the barrier semaphores or writes to memory the agents use.
+ */
+
+#include <unistd.h>
+#include <semaphore.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "stats.h"
+
+/** Values read from the statistics segment at one point in time */
+typedef struct {
+    uint64_t time_ns;
+    int total_broken;
+    int remaining;
+    int running;
+    bool done;
+    int step[AGENT_COUNT];
+    int moves[AGENT_COUNT];
+    int fixes[AGENT_COUNT];
+    bool exited[AGENT_COUNT];
+    uint64_t wait_ns[AGENT_COUNT];
+} snapshot_t;
+
+static void take_snapshot(const stats_t *s, snapshot_t *snap) {
+    snap->time_ns = stats_now_ns();
+    snap->total_broken = atomic_load_explicit(&s->total_broken, memory_order_relaxed);
+    snap->remaining = atomic_load_explicit(&s->remaining, memory_order_relaxed);
+    snap->running = atomic_load_explicit(&s->running, memory_order_relaxed);
+    snap->done = atomic_load_explicit(&s->done, memory_order_relaxed);
+
+    for (int i = 0; i < AGENT_COUNT; ++i) {
+        const agent_stats_t *agent = &s->agent[i];
+        snap->step[i] = atomic_load_explicit(&agent->step, memory_order_relaxed);
+        snap->moves[i] = atomic_load_explicit(&agent->moves, memory_order_relaxed);
+        snap->fixes[i] = atomic_load_explicit(&agent->fixes, memory_order_relaxed);
+        snap->exited[i] = atomic_load_explicit(&agent->exited, memory_order_relaxed);
+        snap->wait_ns[i] = atomic_load_explicit(&agent->wait_ns, memory_order_relaxed);
+    }
+}
+
+static void show(const stats_t *stats, const snapshot_t *prev, const snapshot_t *cur, bool clear) {
+    double elapsed = (cur->time_ns - atomic_load_explicit(&stats->start_ns, memory_order_relaxed)) / 1e9;
+    double interval = (cur->time_ns - prev->time_ns) / 1e9;
+
+    if (clear)
+        printf("\033[H\033[J");
+
+    printf("elapsed %.1fs  broken %d/%d  running %d/%d%s\n",
+            elapsed, cur->remaining, cur->total_broken, cur->running, AGENT_COUNT, cur->done ? "  done" : "");
+    printf("%5s %10s %10s %8s %8s %8s %7s\n", "agent", "step", "steps/s", "moves", "fixes", "fixes/s", "wait%");
+
+    int steps = 0, fixes = 0;
+    double step_rate = 0, fix_rate = 0;
+    for (int i = 0; i < AGENT_COUNT; ++i) {
+        double agent_steps = interval > 0 ? (cur->step[i] - prev->step[i]) / interval : 0;
+        double agent_fixes = interval > 0 ? (cur->fixes[i] - prev->fixes[i]) / interval : 0;
+        double wait = interval > 0 ? 100.0 * (cur->wait_ns[i] - prev->wait_ns[i]) / (interval * 1e9) : 0;
+
+        printf("%5d %10d %10.0f %8d %8d %8.1f %6.1f%%%s\n", i+1, cur->step[i], agent_steps,
+                cur->moves[i], cur->fixes[i], agent_fixes, wait, cur->exited[i] ? "  exited" : "");
+
+        steps += cur->step[i];
+        fixes += cur->fixes[i];
+        step_rate += agent_steps;
+        fix_rate += agent_fixes;
+    }
+    printf("%5s %10d %10.0f %8s %8d %8.1f\n", "all", steps, step_rate, "", fixes, fix_rate);
+    fflush(stdout);
+}
+
+static void print_usage(void) {
+    printf("Usage: ./repairmen-top [-i interval_ms] [-n count]\n"
+           "Waits for a run to start, then refreshes every interval until the run is done or count refreshes\n");
+}
+
+int main(int argc, char *argv[]) {
+    int interval_ms = 500, count = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "i:n:")) != -1) {
+        switch (opt) {
+            case 'i': interval_ms = strtol(optarg, NULL, 0); break;
+            case 'n': count = strtol(optarg, NULL, 0); break;
+            default:
+                print_usage();
+                return -1;
+        }
+    }
+
+    if (interval_ms <= 0 || count < 0) {
+        print_usage();
+        return -1;
+    }
+
+    // Runs create the segment as they start, so keep looking for one
+    const stats_t *stats;
+    while (!(stats = stats_attach(SHM_STATS_NAME))) {
+        if (errno != ENOENT && errno != EAGAIN && errno != EINVAL) {
+            printf("Attaching to %s failed: %s\n", SHM_STATS_NAME, strerror(errno));
+            return -1;
+        }
+        usleep(interval_ms * 1000);
+    }
+
+    bool clear = isatty(STDOUT_FILENO);
+    snapshot_t prev, cur;
+    take_snapshot(stats, &prev);
+
+    for (int i = 0; count == 0 || i < count; ++i) {
+        usleep(interval_ms * 1000);
+        take_snapshot(stats, &cur);
+        show(stats, &prev, &cur, clear);
+        prev = cur;
+
+        if (cur.done)
+            break;
+    }
+
+    stats_detach(stats);
+    return 0;
+}
@@ -0,0 +1,405 @@
+/**
+ * @file scenario.c
+ * @brief Implementation for reading and writing scenario files
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <semaphore.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "scenario.h"
+#include "sparse.h"
+
+/** Maximum number of bytes in a LEB128 encoded 64-bit integer */
+#define VARINT_MAX_BYTES 10
+
+static const uint8_t *read_varint(const uint8_t *p, const uint8_t *end, uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; p < end && shift < 7 * VARINT_MAX_BYTES; shift += 7) {
+        uint8_t byte = *p++;
+        *value |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return p;
+    }
+    return NULL;
+}
+
+static uint8_t *write_varint(uint8_t *p, uint64_t value) {
+    while (value >= 0x80) {
+        *p++ = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t) value;
+    return p;
+}
+
+static uint64_t bitmap_size(uint64_t cells) {
+    return (cells + 63) / 64 * sizeof(uint64_t);
+}
+
+static bool agent_valid(const scenario_agent_t *agent, uint32_t rows, uint32_t cols) {
+    return agent->x < rows && agent->y < cols && 0 < agent->target && agent->target <= SCENARIO_MAX_TARGET;
+}
+
+int scenario_open(scenario_t *scenario, const char *path) {
+    memset(scenario, 0, sizeof(*scenario));
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    if ((size_t) st.st_size < sizeof(scenario_header_t)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+
+    // Cells are decoded front to back exactly once
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    scenario->map = map;
+    scenario->size = st.st_size;
+    scenario->header = map;
+    scenario->agents = (const scenario_agent_t *) (scenario->header + 1);
+    scenario->payload = (const uint8_t *) (scenario->agents + scenario->header->agent_count);
+
+    const scenario_header_t *h = scenario->header;
+    uint64_t cells = (uint64_t) h->rows * h->cols;
+    size_t payload_offset = sizeof(scenario_header_t) + (size_t) h->agent_count * sizeof(scenario_agent_t);
+
+    bool valid = h->magic == SCENARIO_MAGIC && h->version == SCENARIO_VERSION &&
+        h->rows > 0 && h->cols > 0 && h->broken_count <= cells &&
+        payload_offset <= scenario->size && h->payload_size <= scenario->size - payload_offset &&
+        (h->encoding == SCENARIO_RLE || (h->encoding == SCENARIO_BITMAP && h->payload_size == bitmap_size(cells)));
+
+    for (uint32_t k = 0; valid && k < h->agent_count; ++k)
+        valid = agent_valid(&scenario->agents[k], h->rows, h->cols);
+
+    if (!valid) {
+        scenario_close(scenario);
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 0;
+}
+
+void scenario_close(scenario_t *scenario) {
+    if (scenario->map)
+        munmap(scenario->map, scenario->size);
+    memset(scenario, 0, sizeof(*scenario));
+}
+
+static int for_each_rle_run(const scenario_t *scenario, scenario_run_func_t func, void *arg) {
+    const uint8_t *p = scenario->payload;
+    const uint8_t *end = p + scenario->header->payload_size;
+    uint64_t cells = (uint64_t) scenario->header->rows * scenario->header->cols;
+    uint64_t index = 0;
+
+    while (p < end) {
+        uint64_t skip, run;
+        p = read_varint(p, end, &skip);
+        if (p)
+            p = read_varint(p, end, &run);
+
+        if (!p || cells - index < skip || cells - index - skip < run) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        index += skip;
+        if (run > 0) {
+            int status = func(index, run, arg);
+            if (status != 0)
+                return status;
+        }
+        index += run;
+    }
+
+    return 0;
+}
+
+static int for_each_bitmap_run(const scenario_t *scenario, scenario_run_func_t func, void *arg) {
+    uint64_t n_words = scenario->header->payload_size / sizeof(uint64_t);
+    uint64_t cells = (uint64_t) scenario->header->rows * scenario->header->cols;
+
+    // Runs may continue across word boundaries, so the current one is only reported once it ends
+    uint64_t first = 0, count = 0;
+    for (uint64_t w = 0; w < n_words; ++w) {
+        // The payload follows a variable number of agent records, so words may be unaligned
+        uint64_t word;
+        memcpy(&word, scenario->payload + w * sizeof(word), sizeof(word));
+        int bit = 0;
+
+        while (word != 0) {
+            int zeros = __builtin_ctzll(word);
+            word >>= zeros;
+            bit += zeros;
+
+            int ones = ~word == 0 ? 64 - bit : __builtin_ctzll(~word);
+            uint64_t index = w * 64 + bit;
+
+            if (count > 0 && first + count == index) {
+                count += ones;
+            }
+            else {
+                if (count > 0) {
+                    int status = func(first, count, arg);
+                    if (status != 0)
+                        return status;
+                }
+                first = index;
+                count = ones;
+            }
+
+            word = ones == 64 ? 0 : word >> ones;
+            bit += ones;
+        }
+    }
+
+    if (count > 0 && cells < first + count) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (count > 0)
+        return func(first, count, arg);
+
+    return 0;
+}
+
+int scenario_for_each_run(const scenario_t *scenario, scenario_run_func_t func, void *arg) {
+    if (scenario->header->encoding == SCENARIO_BITMAP)
+        return for_each_bitmap_run(scenario, func, arg);
+    return for_each_rle_run(scenario, func, arg);
+}
+
+/** State used while loading runs into the dense grid */
+typedef struct {
+    cell_t *cells;      ///< First cell of the grid in row-major order
+    uint64_t loaded;    ///< Number of broken cells loaded so far
+} dense_load_t;
+
+static int load_dense_run(uint64_t first, uint64_t count, void *arg) {
+    dense_load_t *load = arg;
+    for (uint64_t i = first; i < first + count; ++i)
+        atomic_store_explicit(&load->cells[i].fixed, false, memory_order_relaxed);
+    load->loaded += count;
+    return 0;
+}
+
+// Agents must start on distinct cells
+static bool agents_distinct(const scenario_t *scenario) {
+    for (int k = 0; k < AGENT_COUNT; ++k)
+        for (int j = 0; j < k; ++j)
+            if (scenario->agents[k].x == scenario->agents[j].x && scenario->agents[k].y == scenario->agents[j].y)
+                return false;
+    return true;
+}
+
+static int load_agents(shared_mem_t *mem, const scenario_t *scenario, int targets[AGENT_COUNT]) {
+    for (int k = 0; k < AGENT_COUNT; ++k) {
+        mem->start[k][0] = scenario->agents[k].x;
+        mem->start[k][1] = scenario->agents[k].y;
+        targets[k] = scenario->agents[k].target;
+
+        cell_t *cell = grid_cell(mem, mem->start[k]);
+        if (!cell)
+            return -1;
+        atomic_store_explicit(&cell->occupant, k, memory_order_relaxed);
+    }
+    return 0;
+}
+
+int scenario_load(shared_mem_t *mem, const scenario_t *scenario, int targets[AGENT_COUNT]) {
+    const scenario_header_t *h = scenario->header;
+    if (h->rows != GRID_SIZE || h->cols != GRID_SIZE || h->agent_count != AGENT_COUNT || !agents_distinct(scenario)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (int i = 0; i < GRID_SIZE; ++i)
+        for (int j = 0; j < GRID_SIZE; ++j)
+            cell_init(&mem->grid[i][j], true);
+
+    dense_load_t load = {&mem->grid[0][0], 0};
+    int status = scenario_for_each_run(scenario, load_dense_run, &load);
+    if (status != 0)
+        return status;
+
+    if (load.loaded != h->broken_count) {
+        errno = EINVAL;
+        return -1;
+    }
+    atomic_store_explicit(&mem->total_broken, load.loaded, memory_order_relaxed);
+
+    return load_agents(mem, scenario, targets);
+}
+
+/** State used while loading runs into a sparse grid */
+typedef struct {
+    sparse_grid_t *grid;    ///< Grid receiving the broken cells
+    uint64_t loaded;        ///< Number of broken cells loaded so far
+} sparse_load_t;
+
+static int load_sparse_run(uint64_t first, uint64_t count, void *arg) {
+    sparse_load_t *load = arg;
+    for (uint64_t i = first; i < first + count; ++i) {
+        int pos[2] = {i / load->grid->cols, i % load->grid->cols};
+        cell_t *cell = sparse_get(load->grid, pos);
+        if (!cell)
+            return -1;
+        atomic_store_explicit(&cell->fixed, false, memory_order_relaxed);
+    }
+    load->loaded += count;
+    return 0;
+}
+
+int scenario_load_sparse(shared_mem_t *mem, sparse_grid_t *grid, const scenario_t *scenario, int targets[AGENT_COUNT]) {
+    const scenario_header_t *h = scenario->header;
+    if (h->rows != (uint32_t) grid->rows || h->cols != (uint32_t) grid->cols ||
+            h->agent_count != AGENT_COUNT || !agents_distinct(scenario)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    sparse_load_t load = {grid, 0};
+    int status = scenario_for_each_run(scenario, load_sparse_run, &load);
+    if (status != 0)
+        return status;
+
+    if (load.loaded != h->broken_count) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    mem->sparse = grid;
+    mem->bounds[0] = grid->rows;
+    mem->bounds[1] = grid->cols;
+    atomic_store_explicit(&mem->total_broken, load.loaded, memory_order_relaxed);
+
+    return load_agents(mem, scenario, targets);
+}
+
+static int collect_run(uint64_t first, uint64_t count, void *arg) {
+    scenario_cells_t *list = arg;
+    if (count > list->capacity - list->count) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (uint64_t i = first; i < first + count; ++i)
+        list->cells[list->count++] = i;
+    return 0;
+}
+
+int scenario_read_cells(const scenario_t *scenario, scenario_cells_t *list) {
+    list->count = 0;
+    list->capacity = scenario->header->broken_count;
+    list->cells = malloc(sizeof(uint64_t) * (list->capacity > 0 ? list->capacity : 1));
+    if (!list->cells)
+        return -1;
+
+    int status = scenario_for_each_run(scenario, collect_run, list);
+    if (status == 0 && list->count != list->capacity) {
+        errno = EINVAL;
+        status = -1;
+    }
+
+    if (status != 0) {
+        free(list->cells);
+        list->cells = NULL;
+    }
+    return status;
+}
+
+int scenario_write(const char *path, uint32_t rows, uint32_t cols, scenario_encoding_t encoding,
+        const scenario_agent_t *agents, uint32_t agent_count, const uint64_t *broken, uint64_t broken_count) {
+    uint64_t cells = (uint64_t) rows * cols;
+
+    for (uint32_t k = 0; k < agent_count; ++k) {
+        if (!agent_valid(&agents[k], rows, cols)) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    // Worst case for RLE is one (skip, run) pair per broken cell
+    uint64_t capacity = encoding == SCENARIO_BITMAP ? bitmap_size(cells) : 2 * VARINT_MAX_BYTES * broken_count;
+    uint8_t *payload = calloc(capacity > 0 ? capacity : 1, 1);
+    if (!payload)
+        return -1;
+
+    uint64_t payload_size = 0;
+    if (encoding == SCENARIO_BITMAP) {
+        uint64_t *words = (uint64_t *) payload;
+        for (uint64_t i = 0; i < broken_count; ++i)
+            words[broken[i] / 64] |= (uint64_t) 1 << (broken[i] % 64);
+        payload_size = capacity;
+    }
+    else {
+        uint8_t *p = payload;
+        uint64_t index = 0;
+        for (uint64_t i = 0; i < broken_count; ) {
+            // Extend the run over consecutive indices
+            uint64_t run = 1;
+            while (i + run < broken_count && broken[i + run] == broken[i] + run)
+                run ++;
+
+            p = write_varint(p, broken[i] - index);
+            p = write_varint(p, run);
+            index = broken[i] + run;
+            i += run;
+        }
+        payload_size = p - payload;
+    }
+
+    scenario_header_t header = {
+        .magic = SCENARIO_MAGIC,
+        .version = SCENARIO_VERSION,
+        .rows = rows,
+        .cols = cols,
+        .agent_count = agent_count,
+        .encoding = encoding,
+        .broken_count = broken_count,
+        .payload_size = payload_size
+    };
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        free(payload);
+        return -1;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(agents, sizeof(scenario_agent_t), agent_count, file) == agent_count &&
+        fwrite(payload, 1, payload_size, file) == payload_size;
+
+    free(payload);
+    if (fclose(file) != 0 || !ok)
+        return -1;
+
+    return 0;
+}
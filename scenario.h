@@ -0,0 +1,173 @@
+/**
+ * @file scenario.h
+ * @brief Public interface for reading and writing scenario files
+ *
+ * A scenario file holds a scenario_header_t, followed by one scenario_agent_t per agent,
+ * followed by the broken cells. Cells are numbered in row-major order, index = x * cols + y.
+ * With SCENARIO_RLE the broken cells are a list of (skip, run) pairs, each number stored as
+ * an unsigned LEB128 varint: skip fixed cells, then run broken cells. With SCENARIO_BITMAP
+ * they are a bitmap of rows * cols bits in 64-bit words, a set bit meaning broken.
+ *
+ * The header, agent records and bitmap words are stored in the byte order of the host that wrote
+ * the file, so files are mapped and used in place. A file written on a host of the other byte order
+ * is rejected, since its magic number reads swapped.
+ */
+
+#ifndef SCENARIO_H_
+#define SCENARIO_H_
+
+/** Magic number at the start of every scenario file, "RPSC" */
+#define SCENARIO_MAGIC 0x43535052
+
+/** Version of the scenario format written by this build */
+#define SCENARIO_VERSION 1
+
+/** Largest repair target an agent record may hold */
+#define SCENARIO_MAX_TARGET INT32_MAX
+
+/** Encodings available for broken cells */
+typedef enum {
+    SCENARIO_RLE,       ///< Varint (skip, run) pairs, compact for sparse and clustered failures
+    SCENARIO_BITMAP     ///< One bit per cell, compact for dense failures
+} scenario_encoding_t;
+
+/** Fixed size header of a scenario file */
+typedef struct {
+    uint32_t magic;         ///< SCENARIO_MAGIC
+    uint32_t version;       ///< SCENARIO_VERSION
+    uint32_t rows;          ///< Number of rows in the grid
+    uint32_t cols;          ///< Number of columns in the grid
+    uint32_t agent_count;   ///< Number of scenario_agent_t records following the header
+    uint32_t encoding;      ///< One of scenario_encoding_t
+    uint64_t broken_count;  ///< Number of broken cells
+    uint64_t payload_size;  ///< Size of the encoded broken cells in bytes
+} scenario_header_t;
+
+/** Starting position and repair target of an agent */
+typedef struct {
+    uint32_t x;         ///< Starting row
+    uint32_t y;         ///< Starting column
+    uint32_t target;    ///< Number of cells the agent aims to repair before exiting, 1 to SCENARIO_MAX_TARGET
+} scenario_agent_t;
+
+/** A scenario file mapped into memory */
+typedef struct {
+    void *map;                          ///< Start of the mapping
+    size_t size;                        ///< Size of the mapping in bytes
+    const scenario_header_t *header;    ///< Header at the start of the mapping
+    const scenario_agent_t *agents;     ///< Agent records following the header
+    const uint8_t *payload;             ///< Encoded broken cells, not necessarily aligned
+} scenario_t;
+
+/** Broken cells of a scenario, as a list of indices */
+typedef struct {
+    uint64_t *cells;    ///< Row-major index of each broken cell, freed with free
+    uint64_t count;     ///< Number of cells in the list
+    uint64_t capacity;  ///< Number of cells the list can hold
+} scenario_cells_t;
+
+/**
+ * @brief Callback receiving a run of consecutive broken cells
+ *
+ * @param[in] first Row-major index of the first broken cell
+ * @param[in] count Number of broken cells in the run
+ * @param[in] arg   User data passed to scenario_for_each_run
+ *
+ * @return 0 to continue, non-zero to stop iterating
+ */
+typedef int (*scenario_run_func_t)(uint64_t first, uint64_t count, void *arg);
+
+/**
+ * @brief Map a scenario file into memory and validate its header and agent records
+ *
+ * @param[out] scenario Pointer to the scenario structure
+ * @param[in] path      Path of the scenario file
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error
+ */
+int scenario_open(scenario_t *scenario, const char *path);
+
+/**
+ * @brief Unmap a scenario opened with scenario_open
+ *
+ * @param[in] scenario  Pointer to the scenario structure
+ */
+void scenario_close(scenario_t *scenario);
+
+/**
+ * @brief Decode the broken cells of a scenario as runs, in increasing index order
+ *
+ * Cells are decoded straight from the mapping without intermediate buffers.
+ *
+ * @param[in] scenario  Pointer to the scenario structure
+ * @param[in] func      Callback invoked for each run of broken cells
+ * @param[in] arg       User data passed to func
+ *
+ * @return 0 on success, the callback's value if it stopped early, otherwise returns non-zero
+ *         and sets errno to EINVAL if the payload is malformed
+ */
+int scenario_for_each_run(const scenario_t *scenario, scenario_run_func_t func, void *arg);
+
+/**
+ * @brief Load a scenario into the shared grid
+ *
+ * Replaces the grid, total_broken, and starting positions set by initialize_shared_mem.
+ * The scenario must be GRID_SIZE x GRID_SIZE with AGENT_COUNT agents.
+ *
+ * @param[in,out] mem   Pointer to the initialized shared memory structure
+ * @param[in] scenario  Pointer to the scenario structure
+ * @param[out] targets  Repair target of each agent
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error
+ */
+int scenario_load(shared_mem_t *mem, const scenario_t *scenario, int targets[AGENT_COUNT]);
+
+/**
+ * @brief Load a scenario into a sparse grid and attach it to the shared memory
+ *
+ * Replaces the grid, total_broken, and starting positions set by initialize_shared_mem.
+ * Only the broken cells and the starting cells are stored, so grids of any area can be loaded.
+ * The scenario must have the same dimensions as the sparse grid and AGENT_COUNT agents.
+ *
+ * @param[in,out] mem   Pointer to the initialized shared memory structure
+ * @param[in] grid      Pointer to an empty sparse grid
+ * @param[in] scenario  Pointer to the scenario structure
+ * @param[out] targets  Repair target of each agent
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error
+ */
+int scenario_load_sparse(shared_mem_t *mem, sparse_grid_t *grid, const scenario_t *scenario, int targets[AGENT_COUNT]);
+
+/**
+ * @brief Read the broken cells of a scenario into a list, in increasing index order
+ *
+ * The list is allocated for the broken count of the header, and reading stops as soon as the
+ * payload holds more cells than that.
+ *
+ * @param[in] scenario  Pointer to the scenario structure
+ * @param[out] list     List of broken cells, to be freed with free on success
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error, EINVAL if the
+ *         payload doesn't hold exactly the broken count of the header
+ */
+int scenario_read_cells(const scenario_t *scenario, scenario_cells_t *list);
+
+/**
+ * @brief Write a scenario file
+ *
+ * @param[in] path          Path of the scenario file
+ * @param[in] rows          Number of rows in the grid
+ * @param[in] cols          Number of columns in the grid
+ * @param[in] encoding      Encoding used for broken cells
+ * @param[in] agents        Starting position and target of each agent
+ * @param[in] agent_count   Number of agents
+ * @param[in] broken        Row-major indices of broken cells, sorted and without duplicates
+ * @param[in] broken_count  Number of broken cells
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error, EINVAL if an
+ *         agent is outside the grid or has a target out of range
+ */
+int scenario_write(const char *path, uint32_t rows, uint32_t cols, scenario_encoding_t encoding,
+        const scenario_agent_t *agents, uint32_t agent_count, const uint64_t *broken, uint64_t broken_count);
+
+#endif // SCENARIO_H_
@@ -0,0 +1,185 @@
+/**
+ * @file scenario_gen.c
+ * @brief Generates scenario files with sparse or clustered failure distributions
+ */
+
+#include <unistd.h>
+#include <semaphore.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "scenario.h"
+
+/** Give up on reaching the requested failure count after this many rounds without progress */
+#define MAX_STALLED_ROUNDS 64
+
+/** Failure distributions the generator can produce */
+typedef enum {
+    DIST_SPARSE,    ///< Broken cells are spread uniformly over the grid
+    DIST_CLUSTERED  ///< Broken cells are grouped around a few random centers
+} distribution_t;
+
+static uint64_t rng_state;
+
+// splitmix64, so that indices on grids with more than 2^31 cells are reachable
+static uint64_t next_random(void) {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+static double next_uniform(void) {
+    return (next_random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Standard normal deviate using the Box-Muller transform
+static double next_normal(void) {
+    double u = next_uniform(), v = next_uniform();
+    return sqrt(-2.0 * log(u > 0 ? u : 1e-300)) * cos(2.0 * M_PI * v);
+}
+
+static int compare_index(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static int64_t clamp(int64_t value, int64_t max) {
+    return value < 0 ? 0 : (value > max ? max : value);
+}
+
+static void print_usage(void) {
+    printf("Usage: ./scenario_gen -o [file] [-r rows] [-c cols] [-d sparse|clustered] [-p rate]\n"
+           "                      [-k clusters] [-R radius] [-e rle|bitmap] [-T target] [-s seed]\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = NULL;
+    uint32_t rows = GRID_SIZE, cols = GRID_SIZE, target = 0;
+    distribution_t dist = DIST_SPARSE;
+    scenario_encoding_t encoding = SCENARIO_RLE;
+    double rate = 0.5, radius = 2.0;
+    int clusters = 4;
+    rng_state = time(NULL);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:r:c:d:p:k:R:e:T:s:")) != -1) {
+        switch (opt) {
+            case 'o': path = optarg; break;
+            case 'r': rows = strtoul(optarg, NULL, 0); break;
+            case 'c': cols = strtoul(optarg, NULL, 0); break;
+            case 'p': rate = strtod(optarg, NULL); break;
+            case 'k': clusters = strtol(optarg, NULL, 0); break;
+            case 'R': radius = strtod(optarg, NULL); break;
+            case 'T': target = strtoul(optarg, NULL, 0); break;
+            case 's': rng_state = strtoull(optarg, NULL, 0); break;
+            case 'd':
+                if (strcmp(optarg, "sparse") == 0)
+                    dist = DIST_SPARSE;
+                else if (strcmp(optarg, "clustered") == 0)
+                    dist = DIST_CLUSTERED;
+                else {
+                    print_usage();
+                    return -1;
+                }
+                break;
+            case 'e':
+                if (strcmp(optarg, "rle") == 0)
+                    encoding = SCENARIO_RLE;
+                else if (strcmp(optarg, "bitmap") == 0)
+                    encoding = SCENARIO_BITMAP;
+                else {
+                    print_usage();
+                    return -1;
+                }
+                break;
+            default:
+                print_usage();
+                return -1;
+        }
+    }
+
+    if (!path || rows < 2 || cols < 2 || rate < 0 || 1 < rate || clusters <= 0 || radius <= 0 || SCENARIO_MAX_TARGET < target) {
+        print_usage();
+        return -1;
+    }
+
+    uint64_t cells = (uint64_t) rows * cols;
+    uint64_t wanted = (uint64_t) (rate * cells + 0.5);
+
+    // Agents can't reach a target above the number of broken cells, so that means "fix everything"
+    if (target == 0)
+        target = wanted < SCENARIO_MAX_TARGET ? wanted + 1 : SCENARIO_MAX_TARGET;
+
+    uint64_t *broken = malloc(sizeof(uint64_t) * (wanted > 0 ? wanted : 1));
+    uint64_t (*centers)[2] = malloc(sizeof(*centers) * clusters);
+    if (!broken || !centers) {
+        printf("Error: Out of memory\n");
+        return -1;
+    }
+
+    for (int c = 0; c < clusters; ++c) {
+        centers[c][0] = next_random() % rows;
+        centers[c][1] = next_random() % cols;
+    }
+
+    // Draw the missing cells, then sort and drop duplicates, until enough distinct cells are broken
+    uint64_t count = 0;
+    int stalled = 0;
+    while (count < wanted && stalled < MAX_STALLED_ROUNDS) {
+        uint64_t before = count;
+
+        for (uint64_t i = count; i < wanted; ++i) {
+            if (dist == DIST_SPARSE) {
+                broken[i] = next_random() % cells;
+            }
+            else {
+                uint64_t *center = centers[next_random() % clusters];
+                int64_t x = clamp(center[0] + (int64_t) llround(next_normal() * radius), rows - 1);
+                int64_t y = clamp(center[1] + (int64_t) llround(next_normal() * radius), cols - 1);
+                broken[i] = (uint64_t) x * cols + y;
+            }
+        }
+
+        qsort(broken, wanted, sizeof(uint64_t), compare_index);
+        count = 0;
+        for (uint64_t i = 0; i < wanted; ++i)
+            if (count == 0 || broken[count - 1] != broken[i])
+                broken[count++] = broken[i];
+
+        stalled = count == before ? stalled + 1 : 0;
+    }
+
+    if (count < wanted)
+        printf("Warning: Clusters are saturated, only %llu of %llu cells are broken\n",
+                (unsigned long long) count, (unsigned long long) wanted);
+
+    // Same corners as STARTING_POS, scaled to the scenario grid
+    scenario_agent_t agents[AGENT_COUNT] = {
+        {0, 0, target},
+        {0, cols - 1, target},
+        {rows - 1, 0, target},
+        {rows - 1, cols - 1, target}
+    };
+
+    if (scenario_write(path, rows, cols, encoding, agents, AGENT_COUNT, broken, count) != 0) {
+        printf("Error: Writing %s failed: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    printf("Wrote %s: %ux%u grid, %llu broken cells\n", path, rows, cols, (unsigned long long) count);
+
+    free(centers);
+    free(broken);
+    return 0;
+}
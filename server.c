@@ -0,0 +1,765 @@
+/**
+ * @file server.c
+ * @brief Implementation for a resident server running back-to-back simulations
+ */
+
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <semaphore.h>
+#include <pthread.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "server.h"
+#include "stats.h"
+
+/** Seconds a connection may take to send its request */
+#define REQUEST_TIMEOUT_S 5
+
+/** Milliseconds between checks that the workers of a running slot, or an idle worker's server, are still alive */
+#define ALIVE_CHECK_MS 100
+
+/**
+ * Returns the absolute CLOCK_REALTIME time ms milliseconds from now, as sem_timedwait expects
+ */
+static struct timespec deadline_after(int ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += (ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec ++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return deadline;
+}
+
+/** Requests the server sends to its spawner, each answered with a spawn_reply_t */
+typedef enum {
+    SPAWN_START,    ///< Fork the workers of a slot
+    SPAWN_STOP,     ///< Wait for the workers of a slot to exit, once they were told to quit
+    SPAWN_KILL,     ///< Kill the workers of a slot and wait for them to exit
+    SPAWN_CHECK     ///< Fail with EOWNERDEAD if a worker of a slot has exited
+} spawn_op_t;
+
+/** Request sent to the spawner */
+typedef struct {
+    int op;     ///< One of spawn_op_t
+    int slot;   ///< Index of the slot whose workers the request is about
+} spawn_request_t;
+
+/** Reply of the spawner */
+typedef struct {
+    int status;                 ///< 0 on success, otherwise error holds the errno of the failure
+    int error;                  ///< errno of the failure
+    pid_t worker[AGENT_COUNT];  ///< Workers of the slot after the request
+} spawn_reply_t;
+
+static int write_all(int fd, const void *buf, size_t size) {
+    const char *p = buf;
+    while (size > 0) {
+        // A spawner that died must show up as an error, not kill the server with SIGPIPE
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *buf, size_t size) {
+    char *p = buf;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n == 0)
+            errno = ECONNRESET;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+/**
+ * Run the agent of a slot once per start signal until the slot is closed
+ */
+static void worker(server_slot_t *slot, int id, pid_t spawner_pid) {
+    // Don't outlive a spawner that was killed, it takes the workers along when the server goes away
+    while (true) {
+        struct timespec deadline = deadline_after(ALIVE_CHECK_MS);
+        if (sem_timedwait(&slot->start[id], &deadline) != 0) {
+            if (errno == EINTR || (errno == ETIMEDOUT && getppid() == spawner_pid))
+                continue;
+            return;
+        }
+        if (slot->quit)
+            return;
+
+        srand(slot->seed + id);
+        agent(&slot->mem, id, slot->target[id]);
+        fflush(stdout);
+        sem_post(&slot->done);
+    }
+}
+
+/**
+ * Fork and reap the workers of every slot on request of the server, until the server goes away
+ *
+ * The spawner is forked before the server starts any threads and never starts one itself, so
+ * workers can be forked safely whichever server thread asks for them.
+ */
+static void spawner(server_t *server, int fd) {
+    pid_t spawner_pid = getpid();
+    pid_t worker_pid[SERVER_POOL_SIZE][AGENT_COUNT] = {{0}};
+
+    spawn_request_t request;
+    while (read_all(fd, &request, sizeof(request)) == 0) {
+        spawn_reply_t reply = {0};
+        int s = request.slot;
+        if (s < 0 || s >= SERVER_POOL_SIZE) {
+            reply.status = -1;
+            reply.error = EINVAL;
+            write_all(fd, &reply, sizeof(reply));
+            continue;
+        }
+        pid_t *pids = worker_pid[s];
+
+        switch (request.op) {
+            case SPAWN_START:
+                for (int k = 0; k < AGENT_COUNT && reply.status == 0; ++k) {
+                    pid_t pid = fork();
+                    if (pid == -1) {
+                        reply.status = -1;
+                        reply.error = errno;
+                    }
+                    else if (pid == 0) {
+                        close(fd);
+                        worker(server->slot[s], k, spawner_pid);
+                        exit(0);
+                    }
+                    else {
+                        pids[k] = pid;
+                    }
+                }
+                break;
+
+            case SPAWN_KILL:
+            case SPAWN_STOP:
+                for (int k = 0; k < AGENT_COUNT; ++k) {
+                    if (pids[k] > 0) {
+                        if (request.op == SPAWN_KILL)
+                            kill(pids[k], SIGKILL);
+                        waitpid(pids[k], NULL, 0);
+                    }
+                    pids[k] = 0;
+                }
+                break;
+
+            case SPAWN_CHECK:
+                // Workers never exit while their slot is open
+                for (int k = 0; k < AGENT_COUNT; ++k) {
+                    if (pids[k] > 0 && waitpid(pids[k], NULL, WNOHANG) == pids[k]) {
+                        pids[k] = 0;
+                        reply.status = -1;
+                        reply.error = EOWNERDEAD;
+                    }
+                }
+                break;
+
+            default:
+                reply.status = -1;
+                reply.error = EINVAL;
+        }
+
+        memcpy(reply.worker, pids, sizeof(reply.worker));
+        if (write_all(fd, &reply, sizeof(reply)) != 0)
+            break;
+    }
+
+    // The server is gone, so nobody is left to run the workers
+    for (int s = 0; s < SERVER_POOL_SIZE; ++s) {
+        for (int k = 0; k < AGENT_COUNT; ++k) {
+            if (worker_pid[s][k] > 0) {
+                kill(worker_pid[s][k], SIGKILL);
+                waitpid(worker_pid[s][k], NULL, 0);
+            }
+        }
+    }
+}
+
+/**
+ * Fork the spawner, connected to the server through a socket pair
+ */
+static int start_spawner(server_t *server) {
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+        return -1;
+
+    // Buffered output would otherwise be written again by the spawner and every worker
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == -1) {
+        int error = errno;
+        close(pair[0]);
+        close(pair[1]);
+        errno = error;
+        return -1;
+    }
+    if (pid == 0) {
+        close(pair[0]);
+        spawner(server, pair[1]);
+        exit(0);
+    }
+
+    close(pair[1]);
+    server->spawner = pid;
+    server->spawner_fd = pair[0];
+    return 0;
+}
+
+/**
+ * Send a request about the workers of slot s to the spawner and wait for its reply
+ */
+static int spawner_call(server_t *server, spawn_op_t op, int s) {
+    spawn_request_t request = {op, s};
+    spawn_reply_t reply;
+
+    pthread_mutex_lock(&server->spawner_lock);
+    int status = write_all(server->spawner_fd, &request, sizeof(request));
+    if (status == 0)
+        status = read_all(server->spawner_fd, &reply, sizeof(reply));
+    pthread_mutex_unlock(&server->spawner_lock);
+    if (status != 0)
+        return -1;
+
+    memcpy(server->worker[s], reply.worker, sizeof(server->worker[s]));
+    if (reply.status != 0) {
+        errno = reply.error;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Draw the seed of the next slot reset, never 0 since requests use 0 for no seed
+ */
+static unsigned draw_seed(server_t *server) {
+    pthread_mutex_lock(&server->lock);
+    unsigned seed = (unsigned) rand_r(&server->seed) + 1;
+    pthread_mutex_unlock(&server->lock);
+    return seed;
+}
+
+/**
+ * Initialize the simulation and semaphores of a mapped slot
+ */
+static int init_slot(server_slot_t *slot, unsigned seed) {
+    if (initialize_shared_mem(&slot->mem) != 0)
+        return -1;
+
+    slot->seed = seed;
+    slot->quit = false;
+    if (reset_shared_mem(&slot->mem, seed) != 0)
+        return -1;
+
+    if (sem_init(&slot->done, 1, 0) != 0)
+        return -1;
+    for (int k = 0; k < AGENT_COUNT; ++k)
+        if (sem_init(&slot->start[k], 1, 0) != 0)
+            return -1;
+
+    return 0;
+}
+
+/**
+ * Release what init_slot set up, the mapping stays
+ */
+static void cleanup_slot(server_slot_t *slot) {
+    for (int k = 0; k < AGENT_COUNT; ++k)
+        sem_destroy(&slot->start[k]);
+    sem_destroy(&slot->done);
+    cleanup_shared_mem(&slot->mem);
+}
+
+/**
+ * Map a slot, fault its pages in and initialize it. Workers are forked by the spawner, which needs
+ * the mapping, so every slot is mapped before the spawner is forked.
+ */
+static int create_slot(server_t *server, int s, unsigned seed) {
+    server_slot_t *slot = mmap(NULL, sizeof(server_slot_t), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (slot == MAP_FAILED)
+        return -1;
+    server->slot[s] = slot;
+
+    return init_slot(slot, seed);
+}
+
+/**
+ * Stop the workers of a slot, killing them if a run went wrong and they may be stuck
+ */
+static int stop_workers(server_t *server, int s, bool kill_workers) {
+    server_slot_t *slot = server->slot[s];
+    slot->quit = true;
+    if (!kill_workers)
+        for (int k = 0; k < AGENT_COUNT; ++k)
+            sem_post(&slot->start[k]);
+
+    return spawner_call(server, kill_workers ? SPAWN_KILL : SPAWN_STOP, s);
+}
+
+/**
+ * Stop the workers of a slot and unmap it, so it's never picked for a run again
+ */
+static void destroy_slot(server_t *server, int s, bool kill_workers) {
+    server_slot_t *slot = server->slot[s];
+    if (!slot)
+        return;
+
+    stop_workers(server, s, kill_workers);
+    cleanup_slot(slot);
+
+    pthread_mutex_lock(&server->lock);
+    server->slot[s] = NULL;
+    pthread_mutex_unlock(&server->lock);
+    munmap(slot, sizeof(server_slot_t));
+}
+
+/**
+ * Replace the workers and simulation of a slot whose run went wrong, in the same mapping
+ */
+static int respawn_slot(server_t *server, int s, unsigned seed) {
+    if (stop_workers(server, s, true) != 0)
+        return -1;
+
+    cleanup_slot(server->slot[s]);
+    if (init_slot(server->slot[s], seed) != 0)
+        return -1;
+
+    return spawner_call(server, SPAWN_START, s);
+}
+
+/**
+ * Wait for every worker of a running slot to post done, failing with EOWNERDEAD if one of them died
+ */
+static int wait_for_workers(server_t *server, int s) {
+    server_slot_t *slot = server->slot[s];
+    int done = 0;
+    while (done < AGENT_COUNT) {
+        struct timespec deadline = deadline_after(ALIVE_CHECK_MS);
+        if (sem_timedwait(&slot->done, &deadline) == 0) {
+            done ++;
+            continue;
+        }
+        if (errno != EINTR && errno != ETIMEDOUT)
+            return -1;
+
+        // The others would wait for a dead agent forever
+        if (spawner_call(server, SPAWN_CHECK, s) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+int server_create(server_t *server, const server_request_t *defaults) {
+    memset(server, 0, sizeof(server_t));
+    server->listen_fd = -1;
+    server->spawner_fd = -1;
+    server->defaults = *defaults;
+    server->seed = defaults->seed;
+    pthread_mutex_init(&server->lock, NULL);
+    pthread_cond_init(&server->idle, NULL);
+    pthread_mutex_init(&server->spawner_lock, NULL);
+
+    bool failed = false;
+    for (int s = 0; s < SERVER_POOL_SIZE && !failed; ++s)
+        failed = create_slot(server, s, draw_seed(server)) != 0;
+    if (!failed)
+        failed = start_spawner(server) != 0;
+    for (int s = 0; s < SERVER_POOL_SIZE && !failed; ++s)
+        failed = spawner_call(server, SPAWN_START, s) != 0;
+
+    if (failed) {
+        int error = errno;
+        server_destroy(server);
+        errno = error;
+        return -1;
+    }
+
+    return 0;
+}
+
+void server_destroy(server_t *server) {
+    if (server->listen_fd != -1) {
+        close(server->listen_fd);
+        unlink(server->path);
+        server->listen_fd = -1;
+    }
+
+    // Runs and connections in progress still use the slots
+    pthread_mutex_lock(&server->lock);
+    while (true) {
+        bool busy = server->clients > 0;
+        for (int s = 0; s < SERVER_POOL_SIZE; ++s)
+            busy = busy || server->busy[s];
+        if (!busy)
+            break;
+        pthread_cond_wait(&server->idle, &server->lock);
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    for (int s = 0; s < SERVER_POOL_SIZE; ++s)
+        destroy_slot(server, s, false);
+
+    // The spawner exits once it sees the server's end of the socket closed
+    if (server->spawner_fd != -1) {
+        close(server->spawner_fd);
+        waitpid(server->spawner, NULL, 0);
+        server->spawner_fd = -1;
+    }
+
+    pthread_mutex_destroy(&server->spawner_lock);
+    pthread_cond_destroy(&server->idle);
+    pthread_mutex_destroy(&server->lock);
+}
+
+int server_run(server_t *server, const server_request_t *request, server_reply_t *reply) {
+    // Take the first slot that isn't busy, slots that couldn't be respawned are gone for good
+    pthread_mutex_lock(&server->lock);
+    int s = 0;
+    while (true) {
+        bool any_busy = false;
+        for (s = 0; s < SERVER_POOL_SIZE; ++s) {
+            if (!server->busy[s] && server->slot[s])
+                break;
+            any_busy = any_busy || server->busy[s];
+        }
+        if (s < SERVER_POOL_SIZE)
+            break;
+        if (!any_busy) {
+            pthread_mutex_unlock(&server->lock);
+            errno = ECHILD;
+            return -1;
+        }
+        pthread_cond_wait(&server->idle, &server->lock);
+    }
+    server->busy[s] = true;
+    pthread_mutex_unlock(&server->lock);
+
+    server_slot_t *slot = server->slot[s];
+    shared_mem_t *mem = &slot->mem;
+    int status = 0;
+
+    // Slots are prepared with a fresh seed, asking for another one costs a reset before starting
+    if (request->seed != 0 && request->seed != slot->seed) {
+        slot->seed = request->seed;
+        status = reset_shared_mem(mem, slot->seed);
+    }
+
+    if (status == 0) {
+        mem->mode = request->mode;
+        mem->max_staleness = request->max_staleness;
+        mem->pacing_us = request->pacing_us;
+        memcpy(slot->target, request->target, sizeof(slot->target));
+
+        uint64_t start = stats_now_ns();
+        for (int k = 0; k < AGENT_COUNT; ++k)
+            sem_post(&slot->start[k]);
+        status = wait_for_workers(server, s);
+        reply->run_ns = stats_now_ns() - start;
+    }
+
+    if (status != 0) {
+        // The run failed, replace the slot since its workers and grid can't be trusted anymore
+        int error = errno;
+        if (respawn_slot(server, s, draw_seed(server)) != 0)
+            destroy_slot(server, s, true);
+        errno = error;
+    }
+    else {
+        reply->seed = slot->seed;
+        reply->total_broken = atomic_load(&mem->total_broken);
+        memcpy(reply->result, mem->result, sizeof(reply->result));
+
+        // Get the slot ready for the next run while nobody is waiting on it
+        slot->seed = draw_seed(server);
+        status = reset_shared_mem(mem, slot->seed);
+    }
+
+    pthread_mutex_lock(&server->lock);
+    server->busy[s] = false;
+    pthread_cond_broadcast(&server->idle);
+    pthread_mutex_unlock(&server->lock);
+
+    return status;
+}
+
+int server_listen(server_t *server, const char *path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+        return -1;
+
+    unlink(path);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+
+    server->listen_fd = fd;
+    server->path = path;
+    return 0;
+}
+
+/**
+ * Parse the arguments of a RUN request, anything left out is taken from the server defaults
+ */
+static int parse_run(server_t *server, char *args, server_request_t *request) {
+    *request = server->defaults;
+    request->seed = 0;
+
+    char *save = NULL, *end = NULL;
+    char *token = strtok_r(args, " \t", &save);
+    for (int k = 0; k < AGENT_COUNT; ++k, token = strtok_r(NULL, " \t", &save)) {
+        if (!token)
+            return -1;
+        errno = 0;
+        long target = strtol(token, &end, 0);
+        if (*end != '\0' || errno != 0 || target <= 0 || target > INT_MAX)
+            return -1;
+        request->target[k] = target;
+    }
+
+    for (; token; token = strtok_r(NULL, " \t", &save)) {
+        char *value = strchr(token, '=');
+        if (!value)
+            return -1;
+        *value++ = '\0';
+
+        errno = 0;
+        long long n = strtoll(value, &end, 0);
+        if (*end != '\0' || errno != 0 || n < 0)
+            return -1;
+
+        // Values are checked against their own field, so none of them wraps around
+        if (strcmp(token, "seed") == 0) {
+            if (n > UINT_MAX)
+                return -1;
+            request->seed = n;
+        }
+        else if (n > INT_MAX) {
+            return -1;
+        }
+        else if (strcmp(token, "pacing") == 0) {
+            request->pacing_us = n;
+        }
+        else if (strcmp(token, "staleness") == 0) {
+            request->mode = MODE_RELAXED;
+            request->max_staleness = n;
+        }
+        else {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Write a whole line to a client, without dying if the client has left
+ */
+static void send_line(int fd, const char *line) {
+    size_t len = strlen(line), sent = 0;
+    while (sent < len) {
+        ssize_t n = send(fd, line + sent, len - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        sent += n;
+    }
+}
+
+/**
+ * Read a single line from fd, without the newline
+ */
+static int read_line(int fd, char *line, size_t size) {
+    size_t len = 0;
+    while (len + 1 < size) {
+        ssize_t n = read(fd, line + len, 1);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return -1;
+        if (n == 0 || line[len] == '\n')
+            break;
+        len ++;
+    }
+    line[len] = '\0';
+
+    if (len > 0 && line[len-1] == '\r')
+        line[len-1] = '\0';
+    return 0;
+}
+
+/** Arguments passed to a thread handling a connection */
+typedef struct {
+    server_t *server;
+    int fd;
+} client_args_t;
+
+static void *serve_client(void *data) {
+    client_args_t *args = data;
+    server_t *server = args->server;
+    int fd = args->fd;
+    free(args);
+
+    char line[SERVER_LINE_MAX];
+    if (read_line(fd, line, sizeof(line)) != 0) {
+        send_line(fd, "ERR no request\n");
+    }
+    else if (strcmp(line, "QUIT") == 0) {
+        // Wakes up the accept loop, which sees the server is stopping
+        pthread_mutex_lock(&server->lock);
+        server->stopping = true;
+        pthread_mutex_unlock(&server->lock);
+        shutdown(server->listen_fd, SHUT_RDWR);
+        send_line(fd, "OK\n");
+    }
+    else if (strncmp(line, "RUN ", strlen("RUN ")) == 0) {
+        server_request_t request;
+        server_reply_t reply;
+        if (parse_run(server, line + strlen("RUN "), &request) != 0) {
+            send_line(fd, "ERR usage: RUN t1 t2 t3 t4 [seed=N] [pacing=N] [staleness=N]\n");
+        }
+        else if (server_run(server, &request, &reply) != 0) {
+            snprintf(line, sizeof(line), "ERR %s\n", strerror(errno));
+            send_line(fd, line);
+        }
+        else {
+            int len = snprintf(line, sizeof(line), "OK seed=%u total_broken=%d run_us=%llu",
+                    reply.seed, reply.total_broken, (unsigned long long) (reply.run_ns / 1000));
+            for (int k = 0; k < AGENT_COUNT; ++k)
+                len += snprintf(line + len, sizeof(line) - len, " agent%d=%d/%d/%d", k+1,
+                        reply.result[k].steps, reply.result[k].moves, reply.result[k].fixes);
+            snprintf(line + len, sizeof(line) - len, "\n");
+            send_line(fd, line);
+        }
+    }
+    else {
+        send_line(fd, "ERR unknown request\n");
+    }
+    close(fd);
+
+    pthread_mutex_lock(&server->lock);
+    server->clients --;
+    pthread_cond_broadcast(&server->idle);
+    pthread_mutex_unlock(&server->lock);
+    return NULL;
+}
+
+int server_serve(server_t *server) {
+    while (true) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+
+        pthread_mutex_lock(&server->lock);
+        bool stopping = server->stopping;
+        pthread_mutex_unlock(&server->lock);
+        if (stopping) {
+            if (fd != -1)
+                close(fd);
+            return 0;
+        }
+
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            return -1;
+        }
+
+        // A client that never sends its request can't hold the server up for long
+        struct timeval timeout = {REQUEST_TIMEOUT_S, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        client_args_t *args = malloc(sizeof(client_args_t));
+        pthread_t thread;
+        if (!args) {
+            close(fd);
+            continue;
+        }
+        *args = (client_args_t) {server, fd};
+
+        pthread_mutex_lock(&server->lock);
+        server->clients ++;
+        pthread_mutex_unlock(&server->lock);
+
+        if (pthread_create(&thread, NULL, serve_client, args) != 0) {
+            free(args);
+            close(fd);
+            pthread_mutex_lock(&server->lock);
+            server->clients --;
+            pthread_mutex_unlock(&server->lock);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
+
+int server_request(const char *path, const char *request, char *reply, size_t size) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+        return -1;
+
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+
+    send_line(fd, request);
+    send_line(fd, "\n");
+    int status = read_line(fd, reply, size);
+    close(fd);
+
+    if (status == 0 && reply[0] == '\0') {
+        errno = ECONNRESET;
+        return -1;
+    }
+    return status;
+}
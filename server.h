@@ -0,0 +1,150 @@
+/**
+ * @file server.h
+ * @brief Public interface for a resident server running back-to-back simulations
+ */
+
+#ifndef SERVER_H_
+#define SERVER_H_
+
+/** Default path of the server's Unix socket */
+#define SERVER_SOCKET_PATH "/tmp/repairmen.sock"
+
+/** Number of simulations a server keeps ready, which is also the number of runs it serves at once */
+#define SERVER_POOL_SIZE 2
+
+/** Maximum length of a request or reply line, including the newline */
+#define SERVER_LINE_MAX 256
+
+/**
+ * A simulation kept ready for the next run
+ *
+ * The slot lives in a pre-faulted shared mapping and has its own agent worker processes, forked
+ * by the server's spawner process when the server starts and again if the slot has to be replaced.
+ * Workers block on their start semaphore between runs, and exit once the server is gone.
+ */
+typedef struct {
+    shared_mem_t mem;           ///< Simulation state, reset in bulk after each run
+    sem_t start[AGENT_COUNT];   ///< Posted once per run to start each worker's agent
+    sem_t done;                 ///< Posted by each worker once its agent has exited
+    int target[AGENT_COUNT];    ///< Repair target of each agent in the next run
+    unsigned seed;              ///< Seed the grid was last reset with, worker i seeds its moves with seed + i
+    bool quit;                  ///< Set before posting start to make the workers exit
+} server_slot_t;
+
+/** Parameters of a single run */
+typedef struct {
+    int target[AGENT_COUNT];    ///< Repair target of each agent
+    unsigned seed;              ///< Seed for the broken cells and the agents' moves, or 0 to take the slot's
+    exec_mode_t mode;           ///< Execution model used by agents
+    int max_staleness;          ///< Staleness bound in MODE_RELAXED
+    int pacing_us;              ///< Delay between steps of the first agent, 0 disables pacing
+} server_request_t;
+
+/** Outcome of a single run */
+typedef struct {
+    unsigned seed;                      ///< Seed the run used
+    int total_broken;                   ///< Number of cells that were broken
+    agent_result_t result[AGENT_COUNT]; ///< Summary of each agent's run
+    uint64_t run_ns;                    ///< Time from starting the agents until the last one exited
+} server_reply_t;
+
+/** Resident server running simulations on a pool of slots */
+typedef struct {
+    server_slot_t *slot[SERVER_POOL_SIZE];          ///< Simulations ready to run
+    pid_t worker[SERVER_POOL_SIZE][AGENT_COUNT];    ///< Agent worker processes of each slot, children of the spawner
+    pid_t spawner;                                  ///< Single-threaded process forking and reaping every worker
+    int spawner_fd;                                 ///< Socket connected to the spawner, or -1 before it is started
+    pthread_mutex_t spawner_lock;                   ///< Serializes requests to the spawner
+    bool busy[SERVER_POOL_SIZE];                    ///< True while a slot is running or being reset
+    pthread_mutex_t lock;                           ///< Protects busy, clients, stopping and seed
+    pthread_cond_t idle;                            ///< Signaled when a slot stops being busy or a connection is closed
+    int clients;                                    ///< Number of connections being handled
+    bool stopping;                                  ///< True once a client asked the server to quit
+    unsigned seed;                                  ///< State for drawing the seeds slots are prepared with
+    int listen_fd;                                  ///< Listening socket, or -1 when not listening
+    const char *path;                               ///< Path the socket is bound to
+    server_request_t defaults;                      ///< Parameters used for anything a request leaves out, seed starts the draws
+} server_t;
+
+/**
+ * @brief Start a server with every slot reset and its workers waiting
+ *
+ * Must be called before the process starts any threads, since the spawner is forked from it.
+ * Workers are only ever forked by the spawner, so slots can be replaced from any thread later on.
+ *
+ * @param[out] server   Pointer to the server structure
+ * @param[in] defaults  Parameters used for anything a request leaves out
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error
+ */
+int server_create(server_t *server, const server_request_t *defaults);
+
+/**
+ * @brief Stop the workers and free the slots of a server
+ *
+ * Waits for runs in progress to finish, and removes the socket if the server was listening.
+ *
+ * @param[in] server    Pointer to the server structure
+ */
+void server_destroy(server_t *server);
+
+/**
+ * @brief Run a simulation on the next free slot
+ *
+ * Blocks while every slot is busy. Slots are reset with a freshly drawn seed after each run, so a
+ * request without a seed starts right away. Asking for a specific seed resets the slot first.
+ * Only the time the agents ran for is reported.
+ *
+ * If a worker dies during the run, the run fails and the slot is replaced with a fresh one. A slot
+ * that can't be replaced is unmapped and no run is given to it anymore.
+ *
+ * @param[in] server    Pointer to the server structure
+ * @param[in] request   Parameters of the run
+ * @param[out] reply    Outcome of the run
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error, EOWNERDEAD
+ *         if a worker died, ECHILD if no slot could be respawned
+ */
+int server_run(server_t *server, const server_request_t *request, server_reply_t *reply);
+
+/**
+ * @brief Bind the server to a Unix socket
+ *
+ * A stale socket file at path is replaced.
+ *
+ * @param[in] server    Pointer to the server structure
+ * @param[in] path      Path of the socket, must stay valid while the server is listening
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error
+ */
+int server_listen(server_t *server, const char *path);
+
+/**
+ * @brief Serve requests until a client asks the server to quit
+ *
+ * Each connection is handled on its own thread and sends a single request line:
+ *  - "RUN t1 t2 t3 t4 [seed=N] [pacing=N] [staleness=N]" runs a simulation and replies with
+ *    "OK seed=N total_broken=N run_us=N agent1=steps/moves/fixes ... agent4=steps/moves/fixes".
+ *    A staleness runs agents in MODE_RELAXED.
+ *  - "QUIT" replies "OK" and stops the server.
+ * Malformed requests get a reply starting with "ERR".
+ *
+ * @param[in] server    Pointer to a listening server
+ *
+ * @return 0 once a client asked to quit, otherwise returns non-zero and sets errno to indicate error
+ */
+int server_serve(server_t *server);
+
+/**
+ * @brief Send a single request line to a server and read its reply
+ *
+ * @param[in] path      Path of the server's socket
+ * @param[in] request   Request line without the newline
+ * @param[out] reply    Buffer receiving the reply line without the newline
+ * @param[in] size      Size of the reply buffer
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error
+ */
+int server_request(const char *path, const char *request, char *reply, size_t size);
+
+#endif // SERVER_H_
@@ -0,0 +1,589 @@
+/**
+ * @file shard.c
+ * @brief Implementation for running the simulation with the grid sharded across processes
+ */
+
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <semaphore.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "kernels.h"
+#include "agents.h"
+#include "shard.h"
+
+/** Types of messages exchanged between shards and the coordinator */
+typedef enum {
+    MSG_ASSIGN, ///< Coordinator to shard: rows, seed and agent targets of the shard
+    MSG_HELLO,  ///< Shard to coordinator: number of broken cells in the shard
+    MSG_START,  ///< Coordinator to shard: total number of broken cells in the grid
+    MSG_READY,  ///< Shard to coordinator: proposals of the agents on the shard
+    MSG_GO      ///< Coordinator to shard: resolved actions, positions and states of all agents
+} msg_type_t;
+
+/** Header sent in front of every message */
+typedef struct {
+    int type;   ///< One of msg_type_t
+    int size;   ///< Size of the payload following the header in bytes
+} msg_header_t;
+
+/** Payload of MSG_ASSIGN */
+typedef struct {
+    int index;                  ///< Index of the shard
+    int n_shards;               ///< Total number of shards
+    unsigned seed;              ///< Seed used to generate the broken cells in the shard's rows
+    int targets[AGENT_COUNT];   ///< Repair target of each agent
+} assign_msg_t;
+
+/** State of an agent, carried along when it migrates to another shard */
+typedef struct {
+    int id;                 ///< Agent id
+    int target;             ///< Number of cells this agent aims to repair
+    int n_moves;            ///< Number of moves this agent has made
+    int pos[2];             ///< Current (x,y) position
+    int fixed[AGENT_COUNT]; ///< Number of cells this agent knows each agent has fixed
+} shard_agent_t;
+
+/** Action proposed by an agent for the current round */
+typedef struct {
+    action_t action;        ///< Proposed action
+    int dir;                ///< Proposed direction as an index in MOVE_DELTA, 0 unless moving
+    shard_agent_t agent;    ///< State of the agent when proposing, including its current position
+} proposal_t;
+
+/** Payload of MSG_READY */
+typedef struct {
+    int count;                          ///< Number of proposals
+    proposal_t proposals[AGENT_COUNT];  ///< Proposal of each agent on the shard
+} ready_msg_t;
+
+/** Payload of MSG_GO */
+typedef struct {
+    int alive;                          ///< Number of agents still running after this round
+    action_t action[AGENT_COUNT];       ///< Action of each agent in this round
+    int pos[AGENT_COUNT][2];            ///< Position of each agent after this round
+    shard_agent_t agents[AGENT_COUNT];  ///< State of each agent when it proposed this round's action
+} go_msg_t;
+
+/** Local state of a shard */
+typedef struct {
+    int first_row;                      ///< First row owned by this shard
+    int n_rows;                         ///< Number of rows owned by this shard
+    cell_t *cells;                      ///< Owned rows, n_rows * GRID_SIZE cells
+    int n_agents;                       ///< Number of agents standing on this shard
+    shard_agent_t agents[AGENT_COUNT];  ///< Agents standing on this shard
+} shard_t;
+
+static int write_all(int fd, const void *buf, size_t size) {
+    const char *p = buf;
+    while (size > 0) {
+        // A shard that died must show up as an error, not kill the coordinator with SIGPIPE
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *buf, size_t size) {
+    char *p = buf;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n == 0)
+            errno = ECONNRESET;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static int send_msg(int fd, msg_type_t type, const void *payload, size_t size) {
+    msg_header_t header = {type, size};
+    if (write_all(fd, &header, sizeof(header)) != 0)
+        return -1;
+    return write_all(fd, payload, size);
+}
+
+static int recv_msg(int fd, msg_type_t type, void *payload, size_t size) {
+    msg_header_t header;
+    if (read_all(fd, &header, sizeof(header)) != 0)
+        return -1;
+
+    if (header.type != type || header.size != (int) size) {
+        errno = EPROTO;
+        return -1;
+    }
+    return read_all(fd, payload, size);
+}
+
+void shard_rows(int index, int n_shards, int *first, int *count) {
+    *first = index * GRID_SIZE / n_shards;
+    *count = (index + 1) * GRID_SIZE / n_shards - *first;
+}
+
+static cell_t *shard_cell(shard_t *shard, int pos[2]) {
+    return &shard->cells[(pos[0] - shard->first_row) * GRID_SIZE + pos[1]];
+}
+
+static bool owns_row(shard_t *shard, int row) {
+    return shard->first_row <= row && row < shard->first_row + shard->n_rows;
+}
+
+static bool on_grid(const int pos[2]) {
+    return 0 <= pos[0] && pos[0] < GRID_SIZE && 0 <= pos[1] && pos[1] < GRID_SIZE;
+}
+
+int shard_main(int coord_fd) {
+    static shard_t shard;
+    int status = 0;
+
+    assign_msg_t assign;
+    if (recv_msg(coord_fd, MSG_ASSIGN, &assign, sizeof(assign)) != 0)
+        return -1;
+
+    bool valid = 1 <= assign.n_shards && assign.n_shards <= GRID_SIZE && 0 <= assign.index && assign.index < assign.n_shards;
+    for (int k = 0; k < AGENT_COUNT; ++k)
+        valid &= assign.targets[k] > 0;
+    if (!valid) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    shard_rows(assign.index, assign.n_shards, &shard.first_row, &shard.n_rows);
+    shard.cells = malloc(sizeof(cell_t) * shard.n_rows * GRID_SIZE);
+    if (!shard.cells)
+        return -1;
+
+    // Generate only our own rows
+    srand(assign.seed);
+    int broken = 0;
+    for (int i = 0; i < shard.n_rows * GRID_SIZE; ++i) {
+        bool is_broken = (bool) (rand() % 2);
+        cell_init(&shard.cells[i], !is_broken);
+        broken += is_broken;
+    }
+
+    shard.n_agents = 0;
+    for (int k = 0; k < AGENT_COUNT; ++k) {
+        if (!owns_row(&shard, STARTING_POS[k][0]))
+            continue;
+
+        shard_agent_t *a = &shard.agents[shard.n_agents++];
+        memset(a, 0, sizeof(*a));
+        a->id = k;
+        a->target = assign.targets[k];
+        a->pos[0] = STARTING_POS[k][0];
+        a->pos[1] = STARTING_POS[k][1];
+    }
+
+    int total_broken = 0;
+    status = send_msg(coord_fd, MSG_HELLO, &broken, sizeof(broken));
+    if (status == 0)
+        status = recv_msg(coord_fd, MSG_START, &total_broken, sizeof(total_broken));
+
+    static const int bounds[2] = {GRID_SIZE, GRID_SIZE};
+    const kernel_t *kernel = kernel_select(AGENT_COUNT, bounds);
+    static ready_msg_t ready;
+    static go_msg_t go;
+    while (status == 0) {
+        // Propose an action for every agent standing on our rows
+        ready.count = shard.n_agents;
+        for (int i = 0; i < shard.n_agents; ++i) {
+            shard_agent_t *a = &shard.agents[i];
+            proposal_t *p = &ready.proposals[i];
+
+            p->action = choose_action(kernel, shard_cell(&shard, a->pos), a->id, a->target, total_broken,
+                    a->pos, a->fixed, &p->dir);
+            p->agent = *a;
+        }
+
+        // Signal ready and wait for the coordinator to resolve the round
+        status = send_msg(coord_fd, MSG_READY, &ready, sizeof(ready));
+        if (status != 0)
+            break;
+        status = recv_msg(coord_fd, MSG_GO, &go, sizeof(go));
+        if (status != 0)
+            break;
+
+        // Positions index our cells and ids index per agent state, so a bad message must not reach them
+        bool valid = 0 <= go.alive && go.alive <= AGENT_COUNT;
+        for (int k = 0; k < AGENT_COUNT; ++k)
+            valid &= go.action[k] == ACT_DIE || (on_grid(go.pos[k]) && go.agents[k].id == k);
+        if (!valid) {
+            errno = EPROTO;
+            status = -1;
+            break;
+        }
+
+        int kept = 0;
+        for (int i = 0; i < shard.n_agents; ++i) {
+            shard_agent_t *a = &shard.agents[i];
+            cell_t *cell = shard_cell(&shard, a->pos);
+
+            if (go.action[a->id] == ACT_DIE) {
+                printf("Agent %d exited with %d moves and %d fixes\n", a->id+1, a->n_moves, a->fixed[a->id]);
+                continue;
+            }
+
+            if (go.action[a->id] == ACT_REPAIR && cell_claim_repair(cell))
+                a->fixed[a->id] ++;
+            else if (!is_pos_equal(a->pos, go.pos[a->id]))
+                a->n_moves ++;
+            cell_log_write(cell, a->id, a->fixed[a->id]);
+
+            // Agents moving past our rows are picked up by the shard they moved onto
+            a->pos[0] = go.pos[a->id][0];
+            a->pos[1] = go.pos[a->id][1];
+            if (owns_row(&shard, a->pos[0]))
+                shard.agents[kept++] = *a;
+        }
+        shard.n_agents = kept;
+
+        // Agents moving onto our rows only moved this round, so their state is the one they proposed
+        // with and a move more
+        for (int k = 0; k < AGENT_COUNT; ++k) {
+            shard_agent_t *a = &go.agents[k];
+            if (go.action[k] == ACT_DIE || owns_row(&shard, a->pos[0]) || !owns_row(&shard, go.pos[k][0]))
+                continue;
+
+            a->n_moves ++;
+            a->pos[0] = go.pos[k][0];
+            a->pos[1] = go.pos[k][1];
+            shard.agents[shard.n_agents++] = *a;
+        }
+
+        if (go.alive == 0)
+            break;
+    }
+
+    free(shard.cells);
+    return status;
+}
+
+/**
+ * Collect the proposals of every agent, resolve their moves and send the outcome to every shard,
+ * round after round until every agent has exited
+ */
+static int coordinate_rounds(int n_shards, int shard_fds[], agents_t *agents, shard_report_t *report) {
+    static const int bounds[2] = {GRID_SIZE, GRID_SIZE};
+    int status = 0;
+
+    // Mirrors barrier_t: ready is counted per shard, and exiting agents reduce the total
+    int alive = AGENT_COUNT;
+    go_msg_t go;
+    for (int i = 0; i < AGENT_COUNT; ++i)
+        go.action[i] = ACT_MOVE;
+
+    ready_msg_t ready;
+    while (alive > 0) {
+        // Every running agent proposes exactly once per round, on whichever shard it stands
+        bool proposed[AGENT_COUNT] = {false};
+        int count = 0, running = alive;
+        for (int s = 0; s < n_shards; ++s) {
+            status = recv_msg(shard_fds[s], MSG_READY, &ready, sizeof(ready));
+            if (status != 0)
+                return status;
+
+            if (ready.count < 0 || ready.count > AGENT_COUNT - count) {
+                errno = EPROTO;
+                return -1;
+            }
+            count += ready.count;
+
+            for (int i = 0; i < ready.count; ++i) {
+                proposal_t *p = &ready.proposals[i];
+                int id = p->agent.id;
+                if (id < 0 || id >= AGENT_COUNT || proposed[id] || go.action[id] == ACT_DIE ||
+                        p->dir < 0 || p->dir >= DIRECTION_COUNT) {
+                    errno = EPROTO;
+                    return -1;
+                }
+                proposed[id] = true;
+
+                go.agents[id] = p->agent;
+                go.action[id] = p->action;
+                agents->x[id] = p->agent.pos[0];
+                agents->y[id] = p->agent.pos[1];
+                agents->action[id] = p->action;
+                agents->dir[id] = p->dir;
+
+                // An agent's state when it exits is final, nothing is applied for its last proposal
+                if (p->action == ACT_DIE) {
+                    report->result[id].moves = p->agent.n_moves;
+                    report->result[id].fixes = p->agent.fixed[id];
+                    alive --;
+                }
+                else {
+                    report->result[id].steps ++;
+                }
+            }
+        }
+
+        if (count != running) {
+            errno = EPROTO;
+            return -1;
+        }
+
+        agents_propose(agents, bounds);
+        agents_update_positions(agents);
+        for (int i = 0; i < AGENT_COUNT; ++i) {
+            go.pos[i][0] = agents->x[i];
+            go.pos[i][1] = agents->y[i];
+        }
+        go.alive = alive;
+
+        for (int s = 0; s < n_shards; ++s) {
+            status = send_msg(shard_fds[s], MSG_GO, &go, sizeof(go));
+            if (status != 0)
+                return status;
+        }
+    }
+
+    return 0;
+}
+
+int coordinator_main(int n_shards, int shard_fds[], const int targets[AGENT_COUNT], shard_report_t *report) {
+    int status = 0;
+
+    // Draw seeds here so that shards don't generate identical rows
+    for (int s = 0; s < n_shards; ++s) {
+        assign_msg_t assign = {.index = s, .n_shards = n_shards, .seed = rand()};
+        memcpy(assign.targets, targets, sizeof(assign.targets));
+        status = send_msg(shard_fds[s], MSG_ASSIGN, &assign, sizeof(assign));
+        if (status != 0)
+            return status;
+    }
+
+    // Total broken cells are only known once every shard has generated its rows
+    int total_broken = 0;
+    for (int s = 0; s < n_shards; ++s) {
+        int broken = 0;
+        status = recv_msg(shard_fds[s], MSG_HELLO, &broken, sizeof(broken));
+        if (status != 0)
+            return status;
+        total_broken += broken;
+    }
+
+    printf("total_broken=%d\n", total_broken);
+    fflush(stdout);
+
+    memset(report, 0, sizeof(*report));
+    report->total_broken = total_broken;
+
+    for (int s = 0; s < n_shards; ++s) {
+        status = send_msg(shard_fds[s], MSG_START, &total_broken, sizeof(total_broken));
+        if (status != 0)
+            return status;
+    }
+
+    // Every round moves all agents at once, so their positions are kept together
+    agents_t agents;
+    if (agents_create(&agents, AGENT_COUNT) != 0)
+        return -1;
+
+    status = coordinate_rounds(n_shards, shard_fds, &agents, report);
+    agents_destroy(&agents);
+    return status;
+}
+
+// Listen on or connect to "host:port" over TCP, or to a Unix socket path otherwise
+static int open_socket(const char *address, bool listening) {
+    const char *colon = strrchr(address, ':');
+    if (!colon || strchr(address, '/')) {
+        struct sockaddr_un addr = {.sun_family = AF_UNIX};
+        if (strlen(address) >= sizeof(addr.sun_path)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        strcpy(addr.sun_path, address);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
+            return -1;
+
+        if (listening)
+            unlink(address);
+        bool failed = listening ?
+            bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0 :
+            connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0;
+        if (failed) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            return -1;
+        }
+        return fd;
+    }
+
+    char host[256];
+    size_t len = colon - address;
+    if (len >= sizeof(host)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(host, address, len);
+    host[len] = '\0';
+
+    struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM, .ai_flags = listening ? AI_PASSIVE : 0};
+    struct addrinfo *addrs;
+    if (getaddrinfo(len > 0 ? host : NULL, colon + 1, &hints, &addrs) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = -1, error = EINVAL;
+    for (struct addrinfo *ai = addrs; ai && fd == -1; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd == -1) {
+            error = errno;
+            continue;
+        }
+
+        int one = 1;
+        if (listening)
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        bool failed = listening ?
+            bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || listen(fd, SOMAXCONN) != 0 :
+            connect(fd, ai->ai_addr, ai->ai_addrlen) != 0;
+        if (failed) {
+            error = errno;
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    freeaddrinfo(addrs);
+    if (fd == -1)
+        errno = error;
+    return fd;
+}
+
+// Messages are small and sent once per round, so they shouldn't wait for more data to batch
+static void set_nodelay(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+int shard_listen(const char *address) {
+    return open_socket(address, true);
+}
+
+int run_coordinator(int listen_fd, int n_shards, const int targets[AGENT_COUNT], shard_report_t *report) {
+    int shard_fds[n_shards];
+    int accepted = 0, status = 0;
+
+    // Shards get their rows in the order they connect
+    for (; accepted < n_shards; ++accepted) {
+        shard_fds[accepted] = accept(listen_fd, NULL, NULL);
+        if (shard_fds[accepted] == -1) {
+            if (errno == EINTR) {
+                accepted --;
+                continue;
+            }
+            status = -1;
+            break;
+        }
+        set_nodelay(shard_fds[accepted]);
+    }
+
+    if (status == 0)
+        status = coordinator_main(n_shards, shard_fds, targets, report);
+
+    int error = errno;
+    for (int s = 0; s < accepted; ++s)
+        close(shard_fds[s]);
+    errno = error;
+    return status;
+}
+
+int run_shard(const char *address) {
+    int fd = open_socket(address, false);
+    if (fd == -1)
+        return -1;
+    set_nodelay(fd);
+
+    int status = shard_main(fd);
+
+    int error = errno;
+    close(fd);
+    errno = error;
+    return status;
+}
+
+int run_distributed(int n_shards, const int targets[AGENT_COUNT], shard_report_t *report) {
+    int shard_fds[n_shards];
+    int forked = 0, status = 0;
+
+    fflush(stdout);
+    for (; forked < n_shards; ++forked) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+            status = -1;
+            break;
+        }
+
+        pid_t pid = fork();
+        if (pid == -1) {
+            close(pair[0]);
+            close(pair[1]);
+            status = -1;
+            break;
+        }
+
+        if (pid == 0) {
+            // Only keep our own end of our own link, so the coordinator sees EOF once we're gone
+            for (int s = 0; s < forked; ++s)
+                close(shard_fds[s]);
+            close(pair[0]);
+
+            status = shard_main(pair[1]);
+            if (status != 0)
+                printf("Shard %d failed: %s\n", forked, strerror(errno));
+            exit(status == 0 ? 0 : 1);
+        }
+
+        close(pair[1]);
+        shard_fds[forked] = pair[0];
+    }
+
+    if (status == 0)
+        status = coordinator_main(n_shards, shard_fds, targets, report);
+    int error = errno;
+
+    // Shards still waiting on the coordinator see EOF and exit
+    for (int s = 0; s < forked; ++s)
+        close(shard_fds[s]);
+
+    for (int s = 0; s < forked; ++s) {
+        int wstatus = 0;
+        wait(&wstatus);
+        if ((!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0) && status == 0) {
+            status = -1;
+            error = ECONNRESET;
+        }
+    }
+
+    errno = error;
+    return status;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file shard.h
+ * @brief Public interface for running the simulation with the grid sharded across processes
+ */
+
+#ifndef SHARD_H_
+#define SHARD_H_
+
+/** Outcome of a sharded run, gathered by the coordinator */
+typedef struct {
+    int total_broken;                   ///< Number of broken cells across all shards
+    agent_result_t result[AGENT_COUNT]; ///< Summary of each agent's run
+} shard_report_t;
+
+/**
+ * @brief Compute the rows owned by a shard
+ *
+ * Rows are split into contiguous ranges whose sizes differ by at most one.
+ *
+ * @param[in] index     Index of the shard. Must be in range 0 <= index < n_shards
+ * @param[in] n_shards  Total number of shards
+ * @param[out] first    First row owned by the shard
+ * @param[out] count    Number of rows owned by the shard
+ */
+void shard_rows(int index, int n_shards, int *first, int *count);
+
+/**
+ * @brief Run a single shard of the grid
+ *
+ * The shard gets its rows, seed and the agents' targets from the coordinator, and only allocates
+ * its own rows. Every round it sends the proposals and states of the agents standing on its rows
+ * to the coordinator and applies the resolved moves. Agents only see the cell they stand on, so
+ * nothing else crosses shard borders: the coordinator hands every agent's state back along with
+ * the moves, and an agent crossing a border is picked up from it by the shard it moved onto.
+ *
+ * Messages are sent as native structs, so every host must have the same byte order and GRID_SIZE.
+ *
+ * @param[in] coord_fd  Stream socket connected to the coordinator
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error, e.g.
+ *         ECONNRESET if the coordinator went away or EPROTO if it sent an unexpected message
+ */
+int shard_main(int coord_fd);
+
+/**
+ * @brief Coordinate the rounds of a sharded simulation
+ *
+ * Assigns each shard its rows, then acts as a distributed barrier_t: each round it waits for every
+ * shard to report ready, counting agents that exit as leaving the barrier, resolves all moves with
+ * agents_propose and agents_update_positions, and releases the shards. Returns once every agent has exited.
+ *
+ * @param[in] n_shards  Total number of shards
+ * @param[in] shard_fds Stream socket connected to each shard, in shard index order
+ * @param[in] targets   Repair target of each agent
+ * @param[out] report   Broken cells and summary of each agent's run
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error, e.g.
+ *         ECONNRESET or EPIPE if a shard died, or EPROTO if a shard sent proposals that don't add up
+ */
+int coordinator_main(int n_shards, int shard_fds[], const int targets[AGENT_COUNT], shard_report_t *report);
+
+/**
+ * @brief Listen for shards connecting to a coordinator
+ *
+ * @param[in] address   "host:port" to listen on over TCP, where an empty host means any address,
+ *                      or the path of a Unix socket
+ *
+ * @return Listening socket on success, otherwise returns -1 and sets errno to indicate error
+ */
+int shard_listen(const char *address);
+
+/**
+ * @brief Coordinate a sharded simulation whose shards connect from other processes or hosts
+ *
+ * Shards get their rows in the order they connect.
+ *
+ * @param[in] listen_fd Socket created with shard_listen
+ * @param[in] n_shards  Number of shards to wait for. Must be in range 1 <= n_shards <= GRID_SIZE
+ * @param[in] targets   Repair target of each agent
+ * @param[out] report   Broken cells and summary of each agent's run
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error
+ */
+int run_coordinator(int listen_fd, int n_shards, const int targets[AGENT_COUNT], shard_report_t *report);
+
+/**
+ * @brief Connect to a coordinator and run the shard it assigns
+ *
+ * @param[in] address   "host:port" or Unix socket path the coordinator listens on
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error
+ */
+int run_shard(const char *address);
+
+/**
+ * @brief Run a sharded simulation on this host
+ *
+ * Forks one process per shard, connects each of them to the calling process with a Unix stream
+ * socket, and coordinates the rounds from the calling process. A shard that dies fails the run.
+ *
+ * @param[in] n_shards  Number of shard processes. Must be in range 1 <= n_shards <= GRID_SIZE
+ * @param[in] targets   Repair target of each agent
+ * @param[out] report   Broken cells and summary of each agent's run
+ *
+ * @return 0 on success, otherwise returns non-zero and sets errno to indicate error
+ */
+int run_distributed(int n_shards, const int targets[AGENT_COUNT], shard_report_t *report);
+
+#endif // SHARD_H_
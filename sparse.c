@@ -0,0 +1,109 @@
+/**
+ * @file sparse.c
+ * @brief Implementation for a sparse grid storing only broken and visited cells
+ */
+
+#include <sys/mman.h>
+#include <semaphore.h>
+#include <sched.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <stdatomic.h>
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "sparse.h"
+
+sparse_grid_t *sparse_create(int rows, int cols, uint64_t capacity) {
+    uint64_t slots = 1;
+    while (slots < capacity)
+        slots *= 2;
+
+    // Pages are only backed once a slot on them is used
+    size_t size = sizeof(sparse_grid_t) + slots * sizeof(sparse_entry_t);
+    sparse_grid_t *grid = mmap(NULL, size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (grid == MAP_FAILED)
+        return NULL;
+
+    grid->rows = rows;
+    grid->cols = cols;
+    grid->capacity = slots;
+    grid->size = size;
+    atomic_init(&grid->used, 0);
+
+    return grid;
+}
+
+void sparse_destroy(sparse_grid_t *grid) {
+    munmap(grid, grid->size);
+}
+
+static uint64_t cell_key(sparse_grid_t *grid, int pos[2]) {
+    return (uint64_t) pos[0] * grid->cols + pos[1] + 1;
+}
+
+// Mix the key so neighbouring cells land in unrelated slots
+static uint64_t slot_of(sparse_grid_t *grid, uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    return key & (grid->capacity - 1);
+}
+
+// Wait for a slot that is being initialized by another agent
+static uint64_t load_key(sparse_entry_t *entry) {
+    uint64_t key = atomic_load_explicit(&entry->key, memory_order_acquire);
+    while (key == SPARSE_BUSY) {
+        sched_yield();
+        key = atomic_load_explicit(&entry->key, memory_order_acquire);
+    }
+    return key;
+}
+
+cell_t *sparse_find(sparse_grid_t *grid, int pos[2]) {
+    uint64_t key = cell_key(grid, pos);
+    uint64_t slot = slot_of(grid, key);
+
+    for (uint64_t probe = 0; probe < grid->capacity; ++probe) {
+        sparse_entry_t *entry = &grid->entries[(slot + probe) & (grid->capacity - 1)];
+        uint64_t found = load_key(entry);
+        if (found == key)
+            return &entry->cell;
+        if (found == 0)
+            return NULL;
+    }
+
+    return NULL;
+}
+
+cell_t *sparse_get(sparse_grid_t *grid, int pos[2]) {
+    uint64_t key = cell_key(grid, pos);
+    uint64_t slot = slot_of(grid, key);
+
+    for (uint64_t probe = 0; probe < grid->capacity; ++probe) {
+        sparse_entry_t *entry = &grid->entries[(slot + probe) & (grid->capacity - 1)];
+        uint64_t found = load_key(entry);
+
+        if (found == 0) {
+            // Claim the free slot, or look at what another agent put there instead
+            if (atomic_compare_exchange_strong_explicit(&entry->key, &found, SPARSE_BUSY,
+                        memory_order_acquire, memory_order_relaxed)) {
+                cell_init(&entry->cell, true);
+                atomic_fetch_add_explicit(&grid->used, 1, memory_order_relaxed);
+                atomic_store_explicit(&entry->key, key, memory_order_release);
+                return &entry->cell;
+            }
+            found = load_key(entry);
+        }
+
+        if (found == key)
+            return &entry->cell;
+    }
+
+    errno = ENOSPC;
+    return NULL;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file sparse.h
+ * @brief Public interface for a sparse grid storing only broken and visited cells
+ */
+
+#ifndef SPARSE_H_
+#define SPARSE_H_
+
+/** Key of a slot whose cell is still being initialized */
+#define SPARSE_BUSY UINT64_MAX
+
+/** A slot of the sparse grid hash table */
+typedef struct {
+    atomic_ullong key;  ///< Row-major cell index plus one, 0 if the slot is free, or SPARSE_BUSY
+    cell_t cell;        ///< The cell stored in this slot
+} sparse_entry_t;
+
+/**
+ * Grid of cells stored in a fixed capacity open addressing hash table
+ *
+ * Cells missing from the table are fixed and have an empty log. Slots are claimed with
+ * compare-and-swap and never removed, so lookups and inserts are lock-free and the table can be
+ * shared by agents running as threads or child processes. Memory is only touched for the slots
+ * in use, so its cost depends on broken and visited cells rather than on the grid area.
+ */
+struct sparse_grid {
+    int rows;                   ///< Number of rows in the grid
+    int cols;                   ///< Number of columns in the grid
+    uint64_t capacity;          ///< Number of slots, a power of two
+    size_t size;                ///< Size of the mapping holding the grid in bytes
+    atomic_ullong used;         ///< Number of slots in use
+    sparse_entry_t entries[];   ///< Hash table slots
+};
+
+/**
+ * @brief Create an empty sparse grid in memory shared with child processes
+ *
+ * @param[in] rows      Number of rows in the grid
+ * @param[in] cols      Number of columns in the grid
+ * @param[in] capacity  Maximum number of cells that can be stored, rounded up to a power of two
+ *
+ * @return Pointer to the grid on success, otherwise returns NULL and sets errno to indicate error
+ */
+sparse_grid_t *sparse_create(int rows, int cols, uint64_t capacity);
+
+/**
+ * @brief Free a sparse grid created with sparse_create
+ *
+ * @param[in] grid  Pointer to the sparse grid
+ */
+void sparse_destroy(sparse_grid_t *grid);
+
+/**
+ * @brief Look up a cell without inserting it
+ *
+ * @param[in] grid  Pointer to the sparse grid
+ * @param[in] pos   (x,y) position of the cell
+ *
+ * @return Pointer to the cell, or NULL if it's not stored and therefore fixed with an empty log
+ */
+cell_t *sparse_find(sparse_grid_t *grid, int pos[2]);
+
+/**
+ * @brief Look up a cell, inserting it as a fixed cell with an empty log if it's not stored
+ *
+ * @param[in] grid  Pointer to the sparse grid
+ * @param[in] pos   (x,y) position of the cell
+ *
+ * @return Pointer to the cell on success, otherwise returns NULL and sets errno to ENOSPC if the grid is full
+ */
+cell_t *sparse_get(sparse_grid_t *grid, int pos[2]);
+
+#endif // SPARSE_H_
@@ -0,0 +1,139 @@
+/**
+ * @file stats.c
+ * @brief Implementation for live run statistics
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <semaphore.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "stats.h"
+
+uint64_t stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+stats_t *stats_create(const char *name, int total_broken) {
+    int fd = shm_open(name, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd == -1)
+        return NULL;
+
+    if (ftruncate(fd, sizeof(stats_t)) == -1) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    stats_t *stats = mmap(NULL, sizeof(stats_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (stats == MAP_FAILED) {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    // A segment left over from an earlier run may still hold its counters
+    memset(stats, 0, sizeof(stats_t));
+    stats->agent_count = AGENT_COUNT;
+    atomic_init(&stats->start_ns, stats_now_ns());
+    atomic_init(&stats->total_broken, total_broken);
+    atomic_init(&stats->remaining, total_broken);
+    atomic_init(&stats->running, AGENT_COUNT);
+    atomic_init(&stats->done, false);
+
+    // Monitors only trust the segment once the magic number is in place
+    atomic_thread_fence(memory_order_release);
+    stats->magic = STATS_MAGIC;
+
+    return stats;
+}
+
+void stats_destroy(stats_t *stats, const char *name) {
+    munmap(stats, sizeof(stats_t));
+    shm_unlink(name);
+}
+
+const stats_t *stats_attach(const char *name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t) st.st_size < sizeof(stats_t)) {
+        close(fd);
+        errno = EAGAIN;
+        return NULL;
+    }
+
+    const stats_t *stats = mmap(NULL, sizeof(stats_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (stats == MAP_FAILED)
+        return NULL;
+
+    if (stats->magic != STATS_MAGIC || stats->agent_count != AGENT_COUNT) {
+        stats_detach(stats);
+        errno = EINVAL;
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    return stats;
+}
+
+void stats_detach(const stats_t *stats) {
+    munmap((void *) stats, sizeof(stats_t));
+}
+
+void stats_record_step(stats_t *stats, int id, int steps, int moves, int fixes) {
+    if (!stats)
+        return;
+
+    agent_stats_t *agent = &stats->agent[id];
+    atomic_store_explicit(&agent->moves, moves, memory_order_relaxed);
+    atomic_store_explicit(&agent->fixes, fixes, memory_order_relaxed);
+    atomic_store_explicit(&agent->step, steps, memory_order_relaxed);
+}
+
+void stats_record_fix(stats_t *stats) {
+    if (stats)
+        atomic_fetch_sub_explicit(&stats->remaining, 1, memory_order_relaxed);
+}
+
+void stats_record_inject(stats_t *stats) {
+    if (!stats)
+        return;
+
+    atomic_fetch_add_explicit(&stats->total_broken, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->remaining, 1, memory_order_relaxed);
+}
+
+void stats_record_wait(stats_t *stats, int id, uint64_t ns) {
+    if (!stats)
+        return;
+
+    // Only the agent itself writes its counter, so a load and store is enough
+    atomic_ullong *wait_ns = &stats->agent[id].wait_ns;
+    atomic_store_explicit(wait_ns, atomic_load_explicit(wait_ns, memory_order_relaxed) + ns, memory_order_relaxed);
+}
+
+void stats_record_exit(stats_t *stats, int id) {
+    if (!stats)
+        return;
+
+    atomic_store_explicit(&stats->agent[id].exited, true, memory_order_relaxed);
+    if (atomic_fetch_sub_explicit(&stats->running, 1, memory_order_relaxed) == 1)
+        atomic_store_explicit(&stats->done, true, memory_order_relaxed);
+}
@@ -0,0 +1,125 @@
+/**
+ * @file stats.h
+ * @brief Public interface for live run statistics kept in their own shared memory segment
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+/** Name of the statistics shared memory file in kernel filesystem, next to SHM_NAME */
+#define SHM_STATS_NAME "/repairmen-stats"
+
+/** Magic number identifying a statistics segment, "RPST" in little endian */
+#define STATS_MAGIC 0x54535052
+
+/** Size of a cache line, so agents never write to the same line */
+#define STATS_LINE 64
+
+/**
+ * Counters of one agent
+ *
+ * Only the agent itself writes them, with relaxed atomics, so readers see each counter
+ * untorn but may see them slightly out of step with each other.
+ */
+typedef struct {
+    _Alignas(STATS_LINE) atomic_int step;   ///< Number of steps the agent has done
+    atomic_int moves;                       ///< Number of moves the agent has made
+    atomic_int fixes;                       ///< Number of cells the agent has fixed
+    atomic_bool exited;                     ///< True once the agent has exited
+    atomic_ullong wait_ns;                  ///< Total time spent waiting for other agents in nanoseconds
+} agent_stats_t;
+
+/** Statistics of a run, mapped read-write by the run and read-only by monitors */
+struct stats {
+    uint32_t magic;             ///< STATS_MAGIC once the segment is initialized
+    int agent_count;            ///< Number of entries in agent
+    atomic_ullong start_ns;     ///< CLOCK_MONOTONIC time the run started at in nanoseconds
+    atomic_int total_broken;    ///< Number of cells that needed to be fixed so far
+    atomic_int remaining;       ///< Number of cells still broken
+    atomic_int running;         ///< Number of agents that haven't exited yet
+    atomic_bool done;           ///< True once every agent has exited
+    agent_stats_t agent[AGENT_COUNT];   ///< Counters of each agent
+};
+
+/**
+ * @brief Create and map the statistics segment of a run
+ *
+ * @param[in] name          Name of the shared memory file, normally SHM_STATS_NAME
+ * @param[in] total_broken  Number of cells that need to be fixed
+ *
+ * @return Pointer to the statistics on success, otherwise returns NULL and sets errno to indicate error
+ */
+stats_t *stats_create(const char *name, int total_broken);
+
+/**
+ * @brief Unmap and delete a statistics segment created with stats_create
+ *
+ * @param[in] stats Pointer to the statistics
+ * @param[in] name  Name the segment was created with
+ */
+void stats_destroy(stats_t *stats, const char *name);
+
+/**
+ * @brief Map the statistics segment of a running simulation read-only
+ *
+ * @param[in] name  Name of the shared memory file, normally SHM_STATS_NAME
+ *
+ * @return Pointer to the statistics on success, otherwise returns NULL and sets errno to indicate error
+ */
+const stats_t *stats_attach(const char *name);
+
+/**
+ * @brief Unmap statistics mapped with stats_attach
+ *
+ * @param[in] stats Pointer to the statistics
+ */
+void stats_detach(const stats_t *stats);
+
+/**
+ * @brief Publish the counters of an agent after a step
+ *
+ * @param[in] stats Pointer to the statistics, nothing is recorded if NULL
+ * @param[in] id    Id of the agent
+ * @param[in] steps Number of steps the agent has done
+ * @param[in] moves Number of moves the agent has made
+ * @param[in] fixes Number of cells the agent has fixed
+ */
+void stats_record_step(stats_t *stats, int id, int steps, int moves, int fixes);
+
+/**
+ * @brief Record that a broken cell has been fixed
+ *
+ * @param[in] stats Pointer to the statistics, nothing is recorded if NULL
+ */
+void stats_record_fix(stats_t *stats);
+
+/**
+ * @brief Record that a new failure has been injected
+ *
+ * @param[in] stats Pointer to the statistics, nothing is recorded if NULL
+ */
+void stats_record_inject(stats_t *stats);
+
+/**
+ * @brief Add time an agent has spent waiting for other agents
+ *
+ * @param[in] stats Pointer to the statistics, nothing is recorded if NULL
+ * @param[in] id    Id of the agent
+ * @param[in] ns    Time spent waiting in nanoseconds
+ */
+void stats_record_wait(stats_t *stats, int id, uint64_t ns);
+
+/**
+ * @brief Record that an agent has exited, and mark the run done once every agent has
+ *
+ * @param[in] stats Pointer to the statistics, nothing is recorded if NULL
+ * @param[in] id    Id of the agent
+ */
+void stats_record_exit(stats_t *stats, int id);
+
+/**
+ * @brief Read CLOCK_MONOTONIC in nanoseconds
+ */
+uint64_t stats_now_ns(void);
+
+#endif // STATS_H_
@@ -0,0 +1,146 @@
+#include <semaphore.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "munit/munit.h"
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "kernels.h"
+#include "agents.h"
+
+static MunitResult test_agents_create(const MunitParameter params[], void *data) {
+    int count = strtol(munit_parameters_get(params, "count"), NULL, 0);
+
+    agents_t agents;
+    assert_int(agents_create(&agents, count), ==, 0);
+    assert_int(agents.count, ==, count);
+    assert_int(agents.capacity, >=, count);
+
+    int *arrays[] = {agents.x, agents.y, (int *) agents.action, agents.target, agents.dir, agents.dest_x, agents.dest_y};
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); ++i) {
+        assert_int((uintptr_t) arrays[i] % AGENTS_ALIGN, ==, 0);
+        for (int k = 0; k < count; ++k)
+            assert_int(arrays[i][k], ==, 0);
+    }
+
+    agents_destroy(&agents);
+    return MUNIT_OK;
+}
+
+static MunitResult test_apply_move_batch(const MunitParameter params[], void *data) {
+    int count = strtol(munit_parameters_get(params, "count"), NULL, 0);
+    int size = strtol(munit_parameters_get(params, "size"), NULL, 0);
+    int bounds[2] = {size, size + 1};
+
+    agents_t agents;
+    assert_int(agents_create(&agents, count), ==, 0);
+
+    // Pin agents to each of the four edges in turn, or put them anywhere, and try every direction there
+    for (int k = 0; k < count; ++k) {
+        agents.x[k] = munit_rand_int_range(0, bounds[0] - 1);
+        agents.y[k] = munit_rand_int_range(0, bounds[1] - 1);
+        switch (k % 5) {
+            case 0: agents.x[k] = 0; break;
+            case 1: agents.x[k] = bounds[0] - 1; break;
+            case 2: agents.y[k] = 0; break;
+            case 3: agents.y[k] = bounds[1] - 1; break;
+        }
+        agents.dir[k] = (k + k / 5) % DIRECTION_COUNT;
+    }
+
+    agents_propose(&agents, bounds);
+
+    for (int k = 0; k < count; ++k) {
+        int pos[2] = {agents.x[k], agents.y[k]}, expected[2];
+        apply_move_bounded(pos, agents.dir[k], bounds, expected);
+        assert_int(agents.dest_x[k], ==, expected[0]);
+        assert_int(agents.dest_y[k], ==, expected[1]);
+    }
+
+    agents_destroy(&agents);
+    return MUNIT_OK;
+}
+
+static MunitResult test_agents_update_positions(const MunitParameter params[], void *data) {
+    int count = strtol(munit_parameters_get(params, "count"), NULL, 0);
+    int bounds[2] = {4, 4};
+
+    agents_t agents;
+    assert_int(agents_create(&agents, count), ==, 0);
+
+    int pos[count][2], dest[count][2];
+    action_t action[count];
+    for (int round = 0; round < 100; ++round) {
+        // Crowd the agents into a small grid so destinations conflict
+        for (int k = 0; k < count; ++k) {
+            agents.x[k] = munit_rand_int_range(0, bounds[0] - 1);
+            agents.y[k] = munit_rand_int_range(0, bounds[1] - 1);
+            agents.dir[k] = munit_rand_int_range(0, DIRECTION_COUNT - 1);
+            agents.action[k] = munit_rand_int_range(0, 9) == 0 ? ACT_DIE : ACT_MOVE;
+        }
+        agents_propose(&agents, bounds);
+
+        for (int k = 0; k < count; ++k) {
+            pos[k][0] = agents.x[k];
+            pos[k][1] = agents.y[k];
+            dest[k][0] = agents.dest_x[k];
+            dest[k][1] = agents.dest_y[k];
+            action[k] = agents.action[k];
+        }
+        agents_update_positions(&agents);
+        kernel_generic()->update_positions(pos, action, dest, count);
+
+        for (int k = 0; k < count; ++k) {
+            assert_int(agents.x[k], ==, pos[k][0]);
+            assert_int(agents.y[k], ==, pos[k][1]);
+        }
+    }
+
+    agents_destroy(&agents);
+    return MUNIT_OK;
+}
+
+// Counts that leave a tail after whole 4 and 8 wide vectors are covered as well as exact multiples
+static char* count_params[] = {"0", "1", "7", "13", "64", "10001", NULL};
+static char* update_count_params[] = {"1", "4", "7", "16", NULL};
+static char* size_params[] = {"2", "7", "1000", NULL};
+
+static MunitParameterEnum create_params[] = {
+    {"count", count_params},
+    {NULL, NULL}
+};
+
+static MunitParameterEnum batch_params[] = {
+    {"count", count_params},
+    {"size", size_params},
+    {NULL, NULL}
+};
+
+static MunitParameterEnum update_params[] = {
+    {"count", update_count_params},
+    {NULL, NULL}
+};
+
+static MunitTest tests[] = {
+    {"/test_agents_create", test_agents_create, NULL, NULL, MUNIT_TEST_OPTION_NONE, create_params},
+    {"/test_apply_move_batch", test_apply_move_batch, NULL, NULL, MUNIT_TEST_OPTION_NONE, batch_params},
+    {"/test_agents_update_positions", test_agents_update_positions, NULL, NULL, MUNIT_TEST_OPTION_NONE, update_params},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static MunitSuite suite = {
+    "/agents_tests",            // Test suite name
+    tests,                      // Tests in this suite
+    NULL,                       // No sub-suites
+    1,                          // Number of iterations
+    MUNIT_SUITE_OPTION_NONE     // Options
+};
+
+int main(int argc, char *argv[]) {
+    return munit_suite_main(&suite, NULL, argc, argv);
+}
@@ -102,6 +102,38 @@ static MunitResult test_barrier_signal(const MunitParameter params[], void *data
     return MUNIT_OK;
 }
 
+static void count_hook(void *arg) {
+    (*(int *) arg) ++;
+}
+
+static MunitResult test_barrier_hook(const MunitParameter params[], void *data) {
+    barrier_t *barrier = (barrier_t*) data;
+    int calls = 0;
+
+    barrier_set_hook(barrier, count_hook, &calls);
+
+    // The hook only runs once the last process is ready
+    for (int round = 1; round <= 2; ++round) {
+        for (int i = 0; i < NUM_THREADS; ++i) {
+            assert_int(calls, ==, round - 1);
+            barrier_signal_ready(barrier);
+        }
+        assert_int(calls, ==, round);
+    }
+
+    // An exit can complete a round too, but nothing runs once everyone has left
+    for (int i = 0; i < NUM_THREADS-1; ++i)
+        barrier_signal_ready(barrier);
+    barrier_signal_exit(barrier);
+    assert_int(calls, ==, 3);
+
+    for (int i = 0; i < NUM_THREADS-1; ++i)
+        barrier_signal_exit(barrier);
+    assert_int(calls, ==, 3);
+
+    return MUNIT_OK;
+}
+
 static MunitResult test_barrier_sync(const MunitParameter params[], void* data) {
     barrier_t *barrier = (barrier_t*) data;
     pthread_t threads[NUM_THREADS];
@@ -117,12 +149,37 @@ static MunitResult test_barrier_sync(const MunitParameter params[], void* data)
     return MUNIT_OK;
 }
 
+static MunitResult test_barrier_reset(const MunitParameter params[], void* data) {
+    barrier_t *barrier = (barrier_t*) data;
+    pthread_t threads[NUM_THREADS];
+    int calls = 0;
+
+    barrier_set_hook(barrier, count_hook, &calls);
+
+    // A barrier everyone has left can be used by the same number of threads again
+    for (int run = 1; run <= 3; ++run) {
+        for (int i = 0; i < NUM_THREADS; ++i)
+            pthread_create(&threads[i], NULL, thread_func, barrier);
+        for (int i = 0; i < NUM_THREADS; ++i)
+            pthread_join(threads[i], NULL);
+
+        assert_int(calls, ==, run);
+        assert_int(barrier_reset(barrier, NUM_THREADS), ==, 0);
+        assert_int(barrier->total, ==, NUM_THREADS);
+        assert_int(barrier->ready, ==, 0);
+    }
+
+    return MUNIT_OK;
+}
+
 static MunitTest tests[] = {
     {"/test_barrier_init_cleanup", test_barrier_init_cleanup, setup, teardown, MUNIT_TEST_OPTION_NONE, NULL},
     {"/test_barrier_signal_ready", test_barrier_signal_ready, setup, teardown, MUNIT_TEST_OPTION_NONE, NULL},
     {"/test_barrier_signal_exit", test_barrier_signal_exit, setup, teardown, MUNIT_TEST_OPTION_NONE, NULL},
     {"/test_barrier_signal", test_barrier_signal, setup, teardown, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_barrier_hook", test_barrier_hook, setup, teardown, MUNIT_TEST_OPTION_NONE, NULL},
     {"/test_barrier_sync", test_barrier_sync, setup, teardown, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_barrier_reset", test_barrier_reset, setup, teardown, MUNIT_TEST_OPTION_NONE, NULL},
     {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
 };
 
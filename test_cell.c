@@ -0,0 +1,293 @@
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <semaphore.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "munit/munit.h"
+
+#include "barrier.h"
+#include "repairmen.h"
+
+#define NUM_WORKERS 8
+#define NUM_ROUNDS 20000
+
+// Few cells so that workers keep running into each other
+#define NUM_CELLS 4
+
+// Enough broken cells so that repair claims overlap
+#define NUM_REPAIRS 4096
+
+/** State shared between stress test workers, mapped so that both threads and child processes see it */
+typedef struct {
+    cell_t cells[NUM_CELLS];
+    volatile int inside[NUM_CELLS];     // Plain counters only written by the occupant of the cell
+    cell_t repairs[NUM_REPAIRS];
+    atomic_int claims[NUM_REPAIRS];
+    atomic_int version;
+    atomic_int violations;
+} stress_t;
+
+typedef void (*worker_func_t)(stress_t *stress, int id);
+
+typedef struct {
+    stress_t *stress;
+    worker_func_t func;
+    int id;
+} worker_args_t;
+
+static void* setup(const MunitParameter params[], void *data) {
+    stress_t *stress = mmap(NULL, sizeof(stress_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    assert_true(stress != MAP_FAILED);
+
+    for (int i = 0; i < NUM_CELLS; ++i) {
+        cell_init(&stress->cells[i], true);
+        stress->inside[i] = 0;
+    }
+
+    for (int i = 0; i < NUM_REPAIRS; ++i) {
+        cell_init(&stress->repairs[i], false);
+        atomic_init(&stress->claims[i], 0);
+    }
+
+    atomic_init(&stress->version, 0);
+    atomic_init(&stress->violations, 0);
+
+    return stress;
+}
+
+static void teardown(void *data) {
+    munmap(data, sizeof(stress_t));
+}
+
+static void* worker_thread(void *data) {
+    worker_args_t *args = data;
+    args->func(args->stress, args->id);
+    return NULL;
+}
+
+// Run func concurrently on NUM_WORKERS threads or child processes depending on the "model" parameter
+static void run_workers(const MunitParameter params[], stress_t *stress, worker_func_t func) {
+    if (strcmp(munit_parameters_get(params, "model"), "thread") == 0) {
+        pthread_t threads[NUM_WORKERS];
+        worker_args_t args[NUM_WORKERS];
+
+        for (int i = 0; i < NUM_WORKERS; ++i) {
+            args[i] = (worker_args_t) {stress, func, i};
+            assert_int(pthread_create(&threads[i], NULL, worker_thread, &args[i]), ==, 0);
+        }
+
+        for (int i = 0; i < NUM_WORKERS; ++i)
+            pthread_join(threads[i], NULL);
+    }
+    else {
+        for (int i = 0; i < NUM_WORKERS; ++i) {
+            pid_t pid = fork();
+            assert_int(pid, !=, -1);
+            if (pid == 0) {
+                func(stress, i);
+                _exit(0);
+            }
+        }
+
+        for (int i = 0; i < NUM_WORKERS; ++i) {
+            int wstatus = 0;
+            wait(&wstatus);
+            assert_true(WIFEXITED(wstatus));
+        }
+    }
+}
+
+static void occupy_worker(stress_t *stress, int id) {
+    unsigned seed = id + 1;
+
+    for (int r = 0; r < NUM_ROUNDS; ++r) {
+        int c = rand_r(&seed) % NUM_CELLS;
+        if (!cell_try_occupy(&stress->cells[c], id))
+            continue;
+
+        // Nobody else may be inside while we hold the cell
+        if (stress->inside[c]++ != 0)
+            atomic_fetch_add(&stress->violations, 1);
+        if (atomic_load(&stress->cells[c].occupant) != id)
+            atomic_fetch_add(&stress->violations, 1);
+        if (r % 16 == 0)
+            sched_yield();
+        stress->inside[c]--;
+
+        cell_release(&stress->cells[c]);
+    }
+}
+
+static void claim_worker(stress_t *stress, int id) {
+    // Start each sweep at a different offset so workers race on every cell
+    for (int i = 0; i < NUM_REPAIRS; ++i) {
+        int c = (i + id * NUM_REPAIRS / NUM_WORKERS) % NUM_REPAIRS;
+        if (cell_claim_repair(&stress->repairs[c]))
+            atomic_fetch_add(&stress->claims[c], 1);
+    }
+}
+
+static void log_worker(stress_t *stress, int id) {
+    cell_t *cell = &stress->cells[0];
+
+    for (int r = 0; r < NUM_ROUNDS; ++r) {
+        if (r % 4 == 0) {
+            // Writers take turns through the occupant word and write every entry with a new version
+            while (!cell_try_occupy(cell, id))
+                sched_yield();
+
+            int version = atomic_fetch_add(&stress->version, 1) + 1;
+            for (int k = 0; k < AGENT_COUNT; ++k)
+                cell_log_write(cell, k, version);
+
+            cell_release(cell);
+        }
+        else {
+            // A snapshot taken between two writes is non-increasing and spans at most one version
+            int log[AGENT_COUNT];
+            cell_log_read(cell, log);
+            for (int k = 1; k < AGENT_COUNT; ++k)
+                if (log[k] > log[k-1] || log[0] - log[k] > 1)
+                    atomic_fetch_add(&stress->violations, 1);
+        }
+    }
+}
+
+static MunitResult test_cell_init(const MunitParameter params[], void *data) {
+    cell_t cell;
+    int log[AGENT_COUNT];
+
+    cell_init(&cell, false);
+    assert_false(atomic_load(&cell.fixed));
+    assert_int(atomic_load(&cell.occupant), ==, CELL_EMPTY);
+
+    cell_log_read(&cell, log);
+    for (int k = 0; k < AGENT_COUNT; ++k)
+        assert_int(log[k], ==, 0);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_cell_occupy(const MunitParameter params[], void *data) {
+    cell_t cell;
+    cell_init(&cell, true);
+
+    assert_true(cell_try_occupy(&cell, 1));
+    assert_false(cell_try_occupy(&cell, 2));
+    assert_false(cell_try_occupy(&cell, 1));
+
+    cell_release(&cell);
+    assert_true(cell_try_occupy(&cell, 2));
+    assert_int(atomic_load(&cell.occupant), ==, 2);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_cell_claim_repair(const MunitParameter params[], void *data) {
+    cell_t cell;
+    cell_init(&cell, false);
+
+    assert_true(cell_claim_repair(&cell));
+    assert_true(atomic_load(&cell.fixed));
+    assert_false(cell_claim_repair(&cell));
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_cell_log(const MunitParameter params[], void *data) {
+    cell_t cell;
+    int log[AGENT_COUNT];
+    cell_init(&cell, true);
+
+    for (int k = 0; k < AGENT_COUNT; ++k)
+        cell_log_write(&cell, k, k + 10);
+
+    cell_log_read(&cell, log);
+    for (int k = 0; k < AGENT_COUNT; ++k)
+        assert_int(log[k], ==, k + 10);
+
+    // Sequence is even again once all writes are done
+    assert_int(atomic_load(&cell.log_seq) % 2, ==, 0);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_stress_occupy(const MunitParameter params[], void *data) {
+    stress_t *stress = data;
+
+    run_workers(params, stress, occupy_worker);
+
+    assert_int(atomic_load(&stress->violations), ==, 0);
+    for (int i = 0; i < NUM_CELLS; ++i)
+        assert_int(atomic_load(&stress->cells[i].occupant), ==, CELL_EMPTY);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_stress_claim_repair(const MunitParameter params[], void *data) {
+    stress_t *stress = data;
+
+    run_workers(params, stress, claim_worker);
+
+    // Every broken cell got fixed by exactly one worker
+    for (int i = 0; i < NUM_REPAIRS; ++i) {
+        assert_int(atomic_load(&stress->claims[i]), ==, 1);
+        assert_true(atomic_load(&stress->repairs[i].fixed));
+    }
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_stress_log(const MunitParameter params[], void *data) {
+    stress_t *stress = data;
+
+    run_workers(params, stress, log_worker);
+
+    assert_int(atomic_load(&stress->violations), ==, 0);
+
+    // The last version written is seen in full
+    int log[AGENT_COUNT];
+    cell_log_read(&stress->cells[0], log);
+    for (int k = 0; k < AGENT_COUNT; ++k)
+        assert_int(log[k], ==, atomic_load(&stress->version));
+
+    return MUNIT_OK;
+}
+
+static char* model_params[] = {"thread", "process", NULL};
+
+static MunitParameterEnum stress_params[] = {
+    {"model", model_params},
+    {NULL, NULL}
+};
+
+static MunitTest tests[] = {
+    {"/test_cell_init", test_cell_init, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_cell_occupy", test_cell_occupy, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_cell_claim_repair", test_cell_claim_repair, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_cell_log", test_cell_log, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_stress_occupy", test_stress_occupy, setup, teardown, MUNIT_TEST_OPTION_NONE, stress_params},
+    {"/test_stress_claim_repair", test_stress_claim_repair, setup, teardown, MUNIT_TEST_OPTION_NONE, stress_params},
+    {"/test_stress_log", test_stress_log, setup, teardown, MUNIT_TEST_OPTION_NONE, stress_params},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static MunitSuite suite = {
+    "/cell_tests",              // Test suite name
+    tests,                      // Tests in this suite
+    NULL,                       // No sub-suites
+    1,                          // Number of iterations
+    MUNIT_SUITE_OPTION_NONE     // Options
+};
+
+int main(int argc, char *argv[]) {
+    return munit_suite_main(&suite, NULL, argc, argv);
+}
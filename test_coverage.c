@@ -0,0 +1,203 @@
+#include <unistd.h>
+#include <sys/mman.h>
+#include <semaphore.h>
+#include <pthread.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "munit/munit.h"
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "harness.h"
+#include "coverage.h"
+
+/** Number of rounds of random changes checked against a full recomputation */
+#define FIELD_ROUNDS 200
+
+// Distance to the closest cell not known to be fixed, computed from scratch
+static int expected_dist(coverage_t *coverage, int x, int y) {
+    int best = COVERAGE_FAR;
+    for (int i = 0; i < coverage->bounds[0]; ++i) {
+        for (int j = 0; j < coverage->bounds[1]; ++j) {
+            int c = i * GRID_SIZE + j;
+            if (atomic_load(&coverage->known_fixed[c / 64]) & (1ull << (c % 64)))
+                continue;
+            int dist = abs(i - x) + abs(j - y);
+            if (dist < best)
+                best = dist;
+        }
+    }
+    return best;
+}
+
+static void assert_field(coverage_t *coverage) {
+    for (int i = 0; i < GRID_SIZE; ++i) {
+        for (int j = 0; j < GRID_SIZE; ++j) {
+            bool inside = i < coverage->bounds[0] && j < coverage->bounds[1];
+            assert_int(atomic_load(&coverage->dist[i][j]), ==, inside ? expected_dist(coverage, i, j) : COVERAGE_FAR);
+        }
+    }
+}
+
+static MunitResult test_coverage_field(const MunitParameter params[], void *data) {
+    int bounds[2] = {GRID_SIZE, GRID_SIZE};
+    if (strcmp(munit_parameters_get(params, "bounds"), "partial") == 0) {
+        bounds[0] = GRID_SIZE - 2;
+        bounds[1] = GRID_SIZE / 2;
+    }
+
+    coverage_t *coverage = coverage_create(bounds);
+    assert_not_null(coverage);
+    assert_field(coverage);
+
+    // Explore most of the grid, breaking cells again now and then
+    for (int round = 0; round < FIELD_ROUNDS; ++round) {
+        int changes = munit_rand_int_range(1, 4);
+        for (int k = 0; k < changes; ++k) {
+            int pos[2] = {munit_rand_int_range(0, bounds[0] - 1), munit_rand_int_range(0, bounds[1] - 1)};
+            if (munit_rand_int_range(0, 9) < 8)
+                coverage_visit(coverage, pos);
+            else
+                coverage_mark_broken(coverage, pos);
+        }
+
+        coverage_update(coverage);
+        assert_field(coverage);
+    }
+
+    // Once everything is known to be fixed there's nowhere left to go
+    for (int i = 0; i < bounds[0]; ++i)
+        for (int j = 0; j < bounds[1]; ++j)
+            coverage_visit(coverage, (int[2]) {i, j});
+    coverage_update(coverage);
+    assert_field(coverage);
+    assert_int(coverage_best_dir(coverage, (int[2]) {0, 0}), ==, -1);
+    assert_int(coverage_count_visited(coverage), ==, bounds[0] * bounds[1]);
+
+    coverage_destroy(coverage);
+    return MUNIT_OK;
+}
+
+static MunitResult test_coverage_update(const MunitParameter params[], void *data) {
+    int bounds[2] = {GRID_SIZE, GRID_SIZE};
+    coverage_t *coverage = coverage_create(bounds);
+    assert_not_null(coverage);
+
+    // Nothing changed, nothing is written
+    assert_int(coverage_update(coverage), ==, 0);
+
+    // A single explored cell is cleared and grown back from its neighbours, nothing else is touched
+    coverage_visit(coverage, (int[2]) {0, 0});
+    assert_int(coverage_update(coverage), ==, 2);
+    assert_int(atomic_load(&coverage->dist[0][0]), ==, 1);
+    assert_int(coverage_update(coverage), ==, 0);
+
+    // Visiting it again changes nothing, breaking it restores it
+    coverage_visit(coverage, (int[2]) {0, 0});
+    assert_int(coverage_update(coverage), ==, 0);
+    coverage_mark_broken(coverage, (int[2]) {0, 0});
+    assert_int(coverage_update(coverage), ==, 1);
+    assert_int(atomic_load(&coverage->dist[0][0]), ==, 0);
+    assert_int(coverage_count_visited(coverage), ==, 1);
+
+    // Recording on a missing map does nothing
+    coverage_visit(NULL, (int[2]) {0, 0});
+    coverage_mark_broken(NULL, (int[2]) {0, 0});
+    assert_int(coverage_update(NULL), ==, 0);
+
+    coverage_destroy(coverage);
+    return MUNIT_OK;
+}
+
+static MunitResult test_coverage_best_dir(const MunitParameter params[], void *data) {
+    int bounds[2] = {GRID_SIZE, GRID_SIZE};
+    coverage_t *coverage = coverage_create(bounds);
+    assert_not_null(coverage);
+
+    // Leave only the far corner unexplored
+    for (int i = 0; i < GRID_SIZE; ++i)
+        for (int j = 0; j < GRID_SIZE; ++j)
+            if (i != GRID_SIZE - 1 || j != GRID_SIZE - 1)
+                coverage_visit(coverage, (int[2]) {i, j});
+    coverage_update(coverage);
+
+    // Following the field from the opposite corner gets there in the fewest moves
+    int pos[2] = {0, 0}, moves = 0;
+    while (atomic_load(&coverage->dist[pos[0]][pos[1]]) != 0) {
+        int dir = coverage_best_dir(coverage, pos);
+        assert_int(dir, >, 0);
+        pos[0] += MOVE_DELTA[dir][0];
+        pos[1] += MOVE_DELTA[dir][1];
+        moves ++;
+    }
+    assert_int(moves, ==, 2 * (GRID_SIZE - 1));
+    assert_int(pos[0], ==, GRID_SIZE - 1);
+    assert_int(pos[1], ==, GRID_SIZE - 1);
+
+    coverage_destroy(coverage);
+    return MUNIT_OK;
+}
+
+static MunitResult test_coverage_run(const MunitParameter params[], void *data) {
+    shared_mem_t *mem = harness_map();
+    assert_not_null(mem);
+    if (strcmp(munit_parameters_get(params, "mode"), "relaxed") == 0) {
+        mem->mode = MODE_RELAXED;
+        mem->max_staleness = 1;
+    }
+    mem->coverage = coverage_create(mem->bounds);
+    assert_not_null(mem->coverage);
+
+    assert_int(harness_run(mem, HARNESS_NO_TARGET), ==, 0);
+
+    // Every broken cell got fixed by exactly one agent, after someone stood on it
+    int fixes = 0;
+    for (int i = 0; i < AGENT_COUNT; ++i)
+        fixes += mem->result[i].fixes;
+    assert_int(fixes, ==, mem->total_broken);
+    assert_int(coverage_count_visited(mem->coverage), >=, mem->total_broken);
+
+    coverage_destroy(mem->coverage);
+    harness_unmap(mem);
+    return MUNIT_OK;
+}
+
+static char* bounds_params[] = {"full", "partial", NULL};
+
+static MunitParameterEnum field_params[] = {
+    {"bounds", bounds_params},
+    {NULL, NULL}
+};
+
+static char* mode_params[] = {"lockstep", "relaxed", NULL};
+
+static MunitParameterEnum run_params[] = {
+    {"mode", mode_params},
+    {NULL, NULL}
+};
+
+static MunitTest tests[] = {
+    {"/test_coverage_field", test_coverage_field, NULL, NULL, MUNIT_TEST_OPTION_NONE, field_params},
+    {"/test_coverage_update", test_coverage_update, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_coverage_best_dir", test_coverage_best_dir, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_coverage_run", test_coverage_run, NULL, NULL, MUNIT_TEST_OPTION_NONE, run_params},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static MunitSuite suite = {
+    "/coverage_tests",          // Test suite name
+    tests,                      // Tests in this suite
+    NULL,                       // No sub-suites
+    1,                          // Number of iterations
+    MUNIT_SUITE_OPTION_NONE     // Options
+};
+
+int main(int argc, char *argv[]) {
+    return munit_suite_main(&suite, NULL, argc, argv);
+}
@@ -0,0 +1,154 @@
+#include <unistd.h>
+#include <sys/mman.h>
+#include <semaphore.h>
+#include <pthread.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "munit/munit.h"
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "harness.h"
+#include "inject.h"
+
+/** Number of failures injected while agents run */
+#define INJECT_COUNT 200
+
+static void* setup(const MunitParameter params[], void *data) {
+    shared_mem_t *mem = harness_map();
+    assert_not_null(mem);
+
+    mem->inject = inject_create();
+    assert_not_null(mem->inject);
+    return mem;
+}
+
+static void teardown(void *data) {
+    shared_mem_t *mem = data;
+    inject_destroy(mem->inject);
+    harness_unmap(mem);
+}
+
+static MunitResult test_inject_queue(const MunitParameter params[], void *data) {
+    shared_mem_t *mem = data;
+    inject_queue_t *queue = mem->inject;
+    int pos[2];
+
+    assert_false(inject_pop(queue, pos));
+
+    // Wrap around the ring a few times, filling it up each time
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < INJECT_QUEUE_SIZE; ++i) {
+            int cell[2] = {round, i};
+            assert_true(inject_push(queue, cell));
+        }
+        int extra[2] = {0, 0};
+        assert_false(inject_push(queue, extra));
+
+        for (int i = 0; i < INJECT_QUEUE_SIZE; ++i) {
+            assert_true(inject_pop(queue, pos));
+            assert_int(pos[0], ==, round);
+            assert_int(pos[1], ==, i);
+        }
+        assert_false(inject_pop(queue, pos));
+    }
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_inject_drain(const MunitParameter params[], void *data) {
+    shared_mem_t *mem = data;
+    int total_broken = atomic_load(&mem->total_broken);
+
+    int fixed_pos[2] = {-1, -1}, broken_pos[2] = {-1, -1};
+    for (int i = 0; i < GRID_SIZE * GRID_SIZE; ++i) {
+        int *pos = mem->grid[i / GRID_SIZE][i % GRID_SIZE].fixed ? fixed_pos : broken_pos;
+        pos[0] = i / GRID_SIZE;
+        pos[1] = i % GRID_SIZE;
+    }
+    if (fixed_pos[0] < 0 || broken_pos[0] < 0)
+        return MUNIT_SKIP;
+
+    // Only cells that are fixed count as new failures, even when queued twice
+    assert_true(inject_push(mem->inject, fixed_pos));
+    assert_true(inject_push(mem->inject, broken_pos));
+    assert_true(inject_push(mem->inject, fixed_pos));
+
+    assert_false(inject_finished(mem->inject));
+    assert_int(inject_drain(mem), ==, 1);
+    assert_false(mem->grid[fixed_pos[0]][fixed_pos[1]].fixed);
+    assert_int(atomic_load(&mem->total_broken), ==, total_broken + 1);
+
+    // Finished only once a drain sees the queue closed
+    assert_false(inject_finished(mem->inject));
+    inject_close(mem->inject);
+    assert_false(inject_finished(mem->inject));
+    assert_int(inject_drain(mem), ==, 0);
+    assert_true(inject_finished(mem->inject));
+    assert_true(inject_finished(NULL));
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_inject_run(const MunitParameter params[], void *data) {
+    shared_mem_t *mem = data;
+    mem->pacing_us = 100;
+    if (strcmp(munit_parameters_get(params, "mode"), "relaxed") == 0) {
+        mem->mode = MODE_RELAXED;
+        mem->max_staleness = 2;
+    }
+
+    // Injected failures add to the grid, so only an unbounded target is out of reach
+    harness_t harness;
+    assert_int(harness_start(&harness, mem, INT32_MAX), ==, 0);
+
+    // Agents can't reach their targets, so they keep going until every injected failure is fixed
+    assert_int(inject_run(mem, NULL, INJECT_COUNT, 20000, 1), ==, INJECT_COUNT);
+
+    harness_join(&harness);
+
+    assert_true(inject_finished(mem->inject));
+
+    int fixes = 0;
+    for (int i = 0; i < AGENT_COUNT; ++i)
+        fixes += mem->result[i].fixes;
+    assert_int(fixes, ==, atomic_load(&mem->total_broken));
+
+    for (int i = 0; i < GRID_SIZE; ++i)
+        for (int j = 0; j < GRID_SIZE; ++j)
+            assert_true(mem->grid[i][j].fixed);
+
+    return MUNIT_OK;
+}
+
+static char* mode_params[] = {"lockstep", "relaxed", NULL};
+
+static MunitParameterEnum run_params[] = {
+    {"mode", mode_params},
+    {NULL, NULL}
+};
+
+static MunitTest tests[] = {
+    {"/test_inject_queue", test_inject_queue, setup, teardown, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_inject_drain", test_inject_drain, setup, teardown, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_inject_run", test_inject_run, setup, teardown, MUNIT_TEST_OPTION_NONE, run_params},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static MunitSuite suite = {
+    "/inject_tests",            // Test suite name
+    tests,                      // Tests in this suite
+    NULL,                       // No sub-suites
+    1,                          // Number of iterations
+    MUNIT_SUITE_OPTION_NONE     // Options
+};
+
+int main(int argc, char *argv[]) {
+    return munit_suite_main(&suite, NULL, argc, argv);
+}
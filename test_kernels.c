@@ -0,0 +1,128 @@
+#include <semaphore.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "munit/munit.h"
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "kernels.h"
+
+#define STRINGIFY(X) #X
+#define TO_STRING(X) STRINGIFY(X)
+
+/** Number of random inputs each kernel is checked against */
+#define ROUNDS 200
+
+static MunitResult test_kernel_select(const MunitParameter params[], void *data) {
+    int bounds[2] = {64, 64};
+    assert_string_equal(kernel_select(AGENT_COUNT, bounds)->name, "4x64");
+
+    // Sizes without their own kernel keep the agent count specialization
+    bounds[0] = bounds[1] = 1000;
+    assert_string_equal(kernel_select(AGENT_COUNT, bounds)->name, "4x0");
+
+    bounds[0] = 8;
+    bounds[1] = 16;
+    assert_string_equal(kernel_select(AGENT_COUNT, bounds)->name, "4x0");
+
+    // Only the compiled in agent count is specialized
+    assert_ptr_equal(kernel_select(5, bounds), kernel_generic());
+    bounds[0] = bounds[1] = 64;
+    assert_ptr_equal(kernel_select(64, bounds), kernel_generic());
+    assert_string_equal(kernel_generic()->name, "generic");
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_kernel_matches_generic(const MunitParameter params[], void *data) {
+    int agents = strtol(munit_parameters_get(params, "agents"), NULL, 0);
+    int size = strtol(munit_parameters_get(params, "size"), NULL, 0);
+    int bounds[2] = {size, size};
+
+    const kernel_t *kernel = kernel_select(agents, bounds);
+    const kernel_t *generic = kernel_generic();
+
+    // Sizes with their own kernel must get it, others fall back to the agent count specialization
+    bool specialized = size == 8 || size == 64 || size == 1024;
+    assert_ptr_not_equal(kernel, generic);
+    assert_int(kernel->agents, ==, agents);
+    assert_int(kernel->grid_size, ==, specialized ? size : 0);
+
+    for (int round = 0; round < ROUNDS; ++round) {
+        int fixed[AGENT_COUNT], expected_fixed[AGENT_COUNT], log[AGENT_COUNT];
+        for (int i = 0; i < agents; ++i) {
+            fixed[i] = expected_fixed[i] = munit_rand_int_range(0, 10);
+            log[i] = munit_rand_int_range(0, 10);
+        }
+        kernel->merge_log(fixed, log, agents);
+        generic->merge_log(expected_fixed, log, agents);
+        assert_memory_equal(sizeof(int) * agents, fixed, expected_fixed);
+
+        int id = munit_rand_int_range(0, agents - 1);
+        int target = munit_rand_int_range(0, 10);
+        int total_broken = munit_rand_int_range(0, 10 * agents);
+        assert_int(kernel->should_exit(fixed, agents, id, target, total_broken), ==,
+                generic->should_exit(fixed, agents, id, target, total_broken));
+
+        // Crowd the agents into a corner so destinations conflict
+        int pos[AGENT_COUNT][2], expected_pos[AGENT_COUNT][2], dest[AGENT_COUNT][2];
+        action_t action[AGENT_COUNT];
+        for (int i = 0; i < agents; ++i) {
+            pos[i][0] = munit_rand_int_range(0, size - 1) % 4;
+            pos[i][1] = munit_rand_int_range(0, size - 1) % 4;
+            action[i] = munit_rand_int_range(0, 9) == 0 ? ACT_DIE : ACT_MOVE;
+
+            int dir = munit_rand_int_range(0, DIRECTION_COUNT - 1);
+            int moved[2];
+            apply_move_bounded(pos[i], dir, bounds, dest[i]);
+            kernel->apply_move(pos[i], dir, bounds, moved);
+            assert_int(moved[0], ==, dest[i][0]);
+            assert_int(moved[1], ==, dest[i][1]);
+        }
+        memcpy(expected_pos, pos, sizeof(int) * 2 * agents);
+        kernel->update_positions(pos, action, dest, agents);
+        generic->update_positions(expected_pos, action, dest, agents);
+        assert_memory_equal(sizeof(int) * 2 * agents, pos, expected_pos);
+
+        // The generic kernel must also agree with update_positions
+        memcpy(pos, expected_pos, sizeof(int) * 2 * agents);
+        update_positions(pos, action, dest);
+        generic->update_positions(expected_pos, action, dest, agents);
+        assert_memory_equal(sizeof(int) * 2 * agents, pos, expected_pos);
+    }
+
+    return MUNIT_OK;
+}
+
+// Only the compiled in agent count has specialized kernels
+static char* agents_params[] = {TO_STRING(AGENT_COUNT), NULL};
+static char* size_params[] = {"7", "8", "64", "1024", NULL};
+
+static MunitParameterEnum kernel_params[] = {
+    {"agents", agents_params},
+    {"size", size_params},
+    {NULL, NULL}
+};
+
+static MunitTest tests[] = {
+    {"/test_kernel_select", test_kernel_select, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_kernel_matches_generic", test_kernel_matches_generic, NULL, NULL, MUNIT_TEST_OPTION_NONE, kernel_params},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static MunitSuite suite = {
+    "/kernels_tests",           // Test suite name
+    tests,                      // Tests in this suite
+    NULL,                       // No sub-suites
+    1,                          // Number of iterations
+    MUNIT_SUITE_OPTION_NONE     // Options
+};
+
+int main(int argc, char *argv[]) {
+    return munit_suite_main(&suite, NULL, argc, argv);
+}
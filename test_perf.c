@@ -0,0 +1,110 @@
+#include <unistd.h>
+#include <sys/mman.h>
+#include <semaphore.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "munit/munit.h"
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "harness.h"
+#include "perf.h"
+
+static MunitResult test_perf_counters(const MunitParameter params[], void *data) {
+    perf_counters_t counters;
+    int opened = perf_open(&counters, false);
+    assert_int(opened, >=, 0);
+    assert_int(opened, <=, PERF_FUTEX_WAITS);
+
+    // Blocked waits are only counted from the time the counters were opened
+    perf_count_futex_wait();
+    perf_count_futex_wait();
+    for (int i = 0; i < 100; ++i)
+        sched_yield();
+
+    uint64_t values[PERF_COUNTER_COUNT];
+    perf_read(&counters, values);
+    assert_uint64(values[PERF_FUTEX_WAITS], ==, 2);
+
+    // Counters the kernel refused read as unavailable, the others as a count
+    int available = 0;
+    for (int c = 0; c < PERF_FUTEX_WAITS; ++c)
+        available += values[c] != PERF_UNAVAILABLE;
+    assert_int(available, ==, opened);
+
+    perf_close(&counters);
+    for (int c = 0; c < PERF_COUNTER_COUNT; ++c)
+        assert_int(counters.fd[c], ==, -1);
+
+    perf_read(&counters, values);
+    for (int c = 0; c < PERF_FUTEX_WAITS; ++c)
+        assert_uint64(values[c], ==, PERF_UNAVAILABLE);
+    return MUNIT_OK;
+}
+
+static MunitResult test_perf_agents(const MunitParameter params[], void *data) {
+    shared_mem_t *mem = harness_map();
+    assert_not_null(mem);
+    bool relaxed = strcmp(munit_parameters_get(params, "mode"), "relaxed") == 0;
+    if (relaxed) {
+        mem->mode = MODE_RELAXED;
+        mem->max_staleness = 1;
+    }
+    mem->perf = perf_results_create();
+    assert_not_null(mem->perf);
+    for (int c = 0; c < PERF_COUNTER_COUNT; ++c)
+        assert_uint64(mem->perf->agent[0][c], ==, PERF_UNAVAILABLE);
+
+    assert_int(harness_run(mem, HARNESS_NO_TARGET), ==, 0);
+
+    // Only lockstep agents block on barriers, and over a whole run some of them must have
+    uint64_t futex_waits = 0;
+    for (int i = 0; i < AGENT_COUNT; ++i) {
+        assert_uint64(mem->perf->agent[i][PERF_FUTEX_WAITS], !=, PERF_UNAVAILABLE);
+        futex_waits += mem->perf->agent[i][PERF_FUTEX_WAITS];
+    }
+    if (relaxed)
+        assert_uint64(futex_waits, ==, 0);
+    else
+        assert_uint64(futex_waits, >, 0);
+
+    perf_results_reset(mem->perf);
+    assert_uint64(mem->perf->agent[0][PERF_FUTEX_WAITS], ==, PERF_UNAVAILABLE);
+
+    perf_results_destroy(mem->perf);
+    harness_unmap(mem);
+    return MUNIT_OK;
+}
+
+static char* mode_params[] = {"lockstep", "relaxed", NULL};
+
+static MunitParameterEnum agents_params[] = {
+    {"mode", mode_params},
+    {NULL, NULL}
+};
+
+static MunitTest tests[] = {
+    {"/test_perf_counters", test_perf_counters, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_perf_agents", test_perf_agents, NULL, NULL, MUNIT_TEST_OPTION_NONE, agents_params},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static MunitSuite suite = {
+    "/perf_tests",              // Test suite name
+    tests,                      // Tests in this suite
+    NULL,                       // No sub-suites
+    1,                          // Number of iterations
+    MUNIT_SUITE_OPTION_NONE     // Options
+};
+
+int main(int argc, char *argv[]) {
+    return munit_suite_main(&suite, NULL, argc, argv);
+}
@@ -1,13 +1,19 @@
 #include <semaphore.h>
+#include <pthread.h>
+#include <sched.h>
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdatomic.h>
 
 #define MUNIT_ENABLE_ASSERT_ALIASES
 #include "munit/munit.h"
 
 #include "barrier.h"
 #include "repairmen.h"
+#include "harness.h"
 
 static MunitResult test_shared_mem_init(const MunitParameter params[], void *data) {
     shared_mem_t *mem = malloc(sizeof(shared_mem_t));
@@ -28,6 +34,102 @@ static MunitResult test_shared_mem_init(const MunitParameter params[], void *dat
     return MUNIT_OK;
 }
 
+static MunitResult test_shared_mem_occupants(const MunitParameter params[], void *data) {
+    shared_mem_t *mem = malloc(sizeof(shared_mem_t));
+    if (!mem)
+        return MUNIT_ERROR;
+
+    int status = initialize_shared_mem(mem);
+    assert_int(status, ==, 0);
+    assert_int(mem->mode, ==, MODE_LOCKSTEP);
+
+    // Only the starting corners are occupied, each by its own agent
+    int occupied = 0;
+    for (int i = 0; i < GRID_SIZE; ++i)
+        for (int j = 0; j < GRID_SIZE; ++j)
+            occupied += atomic_load(&mem->grid[i][j].occupant) != CELL_EMPTY;
+    assert_int(occupied, ==, AGENT_COUNT);
+
+    for (int k = 0; k < AGENT_COUNT; ++k) {
+        cell_t *cell = &mem->grid[STARTING_POS[k][0]][STARTING_POS[k][1]];
+        assert_int(atomic_load(&cell->occupant), ==, k);
+        assert_int(atomic_load(&mem->step[k]), ==, 0);
+    }
+
+    cleanup_shared_mem(mem);
+    free(mem);
+    return MUNIT_OK;
+}
+
+/**
+ * Take a consistent snapshot of the relaxed step counters, returns the lead of the fastest running
+ * agent over the slowest, or -1 once no agent is running
+ */
+static int sample_lead(shared_mem_t *mem) {
+    int before[AGENT_COUNT], after[AGENT_COUNT];
+    do {
+        // Counters only grow, so two equal passes saw every counter at the same moment between them
+        for (int k = 0; k < AGENT_COUNT; ++k)
+            before[k] = atomic_load(&mem->step[k]);
+        for (int k = 0; k < AGENT_COUNT; ++k)
+            after[k] = atomic_load(&mem->step[k]);
+    } while (memcmp(before, after, sizeof(before)) != 0);
+
+    int min = INT_MAX, max = -1;
+    for (int k = 0; k < AGENT_COUNT; ++k) {
+        // Agents that have exited no longer hold anyone back
+        if (after[k] == INT_MAX)
+            continue;
+        min = after[k] < min ? after[k] : min;
+        max = after[k] > max ? after[k] : max;
+    }
+    return max < 0 ? -1 : max - min;
+}
+
+static MunitResult test_relaxed_run(const MunitParameter params[], void *data) {
+    int staleness = strtol(munit_parameters_get(params, "staleness"), NULL, 0);
+
+    shared_mem_t *mem = harness_map();
+    assert_not_null(mem);
+    mem->mode = MODE_RELAXED;
+    mem->max_staleness = staleness;
+
+    // Agents are paced at different speeds, so the fast ones keep running into the bound
+    mem->pacing_us = 50;
+    int total_broken = atomic_load(&mem->total_broken);
+
+    harness_t harness;
+    assert_int(harness_start(&harness, mem, HARNESS_NO_TARGET), ==, 0);
+
+    /**
+     * Counters are published as a step finishes, before the agent waits for the others, so an agent
+     * that may start at most staleness steps ahead shows at most one more step than that
+     */
+    int samples = 0, max_lead = 0;
+    while (atomic_load(&mem->running) > 0) {
+        int lead = sample_lead(mem);
+        max_lead = lead > max_lead ? lead : max_lead;
+        samples ++;
+        sched_yield();
+    }
+    harness_join(&harness);
+    assert_int(samples, >, 0);
+    assert_int(max_lead, <=, staleness + 1);
+
+    // Nobody reaches their target, so the run ends once every broken cell was repaired by exactly one agent
+    int fixes = 0;
+    for (int k = 0; k < AGENT_COUNT; ++k)
+        fixes += mem->result[k].fixes;
+    assert_int(fixes, ==, total_broken);
+    assert_int(atomic_load(&mem->total_broken), ==, total_broken);
+    for (int i = 0; i < GRID_SIZE; ++i)
+        for (int j = 0; j < GRID_SIZE; ++j)
+            assert_true(atomic_load(&mem->grid[i][j].fixed));
+
+    harness_unmap(mem);
+    return MUNIT_OK;
+}
+
 static MunitResult test_start_pos(const MunitParameter params[], void *data) {
     int pos[AGENT_COUNT][2];
     initialize_starting_pos(pos);
@@ -214,6 +316,13 @@ static MunitParameterEnum apply_move_params[] = {
     {NULL, NULL}
 };
 
+static char* staleness_params[] = {"0", "1", "3", NULL};
+
+static MunitParameterEnum relaxed_params[] = {
+    {"staleness", staleness_params},
+    {NULL, NULL}
+};
+
 static MunitParameterEnum no_move_params[] = {
     {"x", x_params},
     {"y", y_params},
@@ -222,6 +331,8 @@ static MunitParameterEnum no_move_params[] = {
 
 static MunitTest tests[] = {
     {"/test_shared_mem_init", test_shared_mem_init, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_shared_mem_occupants", test_shared_mem_occupants, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_relaxed_run", test_relaxed_run, NULL, NULL, MUNIT_TEST_OPTION_NONE, relaxed_params},
     {"/test_start_pos", test_start_pos, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
     {"/test_apply_move", test_apply_move, NULL, NULL, MUNIT_TEST_OPTION_NONE, apply_move_params},
     {"/test_no_move", test_no_move, NULL, NULL, MUNIT_TEST_OPTION_NONE, no_move_params},
@@ -0,0 +1,273 @@
+#include <unistd.h>
+#include <semaphore.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "munit/munit.h"
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "scenario.h"
+
+/** Broken cells used by the tests: a run in the first row, a run crossing a row boundary and a lone cell */
+static const uint64_t BROKEN[] = {1, 2, 3, GRID_SIZE - 1, GRID_SIZE, GRID_SIZE * GRID_SIZE - 1};
+#define BROKEN_COUNT (sizeof(BROKEN) / sizeof(BROKEN[0]))
+
+static const scenario_agent_t AGENTS[AGENT_COUNT] = {
+    {1, 1, 3},
+    {1, 2, 4},
+    {2, 1, 5},
+    {2, 2, 6}
+};
+
+static void* setup(const MunitParameter params[], void *data) {
+    char *path = strdup("/tmp/test_scenario_XXXXXX");
+    int fd = mkstemp(path);
+    assert_int(fd, !=, -1);
+    close(fd);
+
+    scenario_encoding_t encoding = strcmp(munit_parameters_get(params, "encoding"), "bitmap") == 0 ?
+        SCENARIO_BITMAP : SCENARIO_RLE;
+
+    int status = scenario_write(path, GRID_SIZE, GRID_SIZE, encoding, AGENTS, AGENT_COUNT, BROKEN, BROKEN_COUNT);
+    assert_int(status, ==, 0);
+
+    return path;
+}
+
+static void teardown(void *data) {
+    unlink(data);
+    free(data);
+}
+
+/** Expands runs back into a list of indices */
+typedef struct {
+    uint64_t indices[GRID_SIZE * GRID_SIZE];
+    uint64_t count;
+    uint64_t runs;
+} collect_t;
+
+static int collect_run(uint64_t first, uint64_t count, void *arg) {
+    collect_t *collect = arg;
+    for (uint64_t i = first; i < first + count; ++i)
+        collect->indices[collect->count++] = i;
+    collect->runs ++;
+    return 0;
+}
+
+static MunitResult test_scenario_runs(const MunitParameter params[], void *data) {
+    scenario_t scenario;
+    int status = scenario_open(&scenario, data);
+    assert_int(status, ==, 0);
+
+    assert_int(scenario.header->rows, ==, GRID_SIZE);
+    assert_int(scenario.header->cols, ==, GRID_SIZE);
+    assert_int(scenario.header->agent_count, ==, AGENT_COUNT);
+    assert_int(scenario.header->broken_count, ==, BROKEN_COUNT);
+
+    collect_t collect = {{0}, 0, 0};
+    status = scenario_for_each_run(&scenario, collect_run, &collect);
+    assert_int(status, ==, 0);
+
+    // Consecutive cells come back as a single run
+    assert_int(collect.count, ==, BROKEN_COUNT);
+    assert_int(collect.runs, ==, 3);
+    for (uint64_t i = 0; i < BROKEN_COUNT; ++i)
+        assert_int(collect.indices[i], ==, BROKEN[i]);
+
+    scenario_close(&scenario);
+    return MUNIT_OK;
+}
+
+static MunitResult test_scenario_load(const MunitParameter params[], void *data) {
+    shared_mem_t *mem = malloc(sizeof(shared_mem_t));
+    if (!mem)
+        return MUNIT_ERROR;
+
+    int status = initialize_shared_mem(mem);
+    assert_int(status, ==, 0);
+
+    scenario_t scenario;
+    status = scenario_open(&scenario, data);
+    assert_int(status, ==, 0);
+
+    int targets[AGENT_COUNT];
+    status = scenario_load(mem, &scenario, targets);
+    assert_int(status, ==, 0);
+    scenario_close(&scenario);
+
+    assert_int(mem->total_broken, ==, BROKEN_COUNT);
+
+    int total_broken = 0;
+    for (int i = 0; i < GRID_SIZE; ++i)
+        for (int j = 0; j < GRID_SIZE; ++j)
+            total_broken += !mem->grid[i][j].fixed;
+    assert_int(total_broken, ==, BROKEN_COUNT);
+
+    for (uint64_t i = 0; i < BROKEN_COUNT; ++i)
+        assert_false(mem->grid[BROKEN[i] / GRID_SIZE][BROKEN[i] % GRID_SIZE].fixed);
+
+    // Agents start where the scenario says, and only there
+    int occupied = 0;
+    for (int i = 0; i < GRID_SIZE; ++i)
+        for (int j = 0; j < GRID_SIZE; ++j)
+            occupied += atomic_load(&mem->grid[i][j].occupant) != CELL_EMPTY;
+    assert_int(occupied, ==, AGENT_COUNT);
+
+    for (int k = 0; k < AGENT_COUNT; ++k) {
+        assert_int(mem->start[k][0], ==, AGENTS[k].x);
+        assert_int(mem->start[k][1], ==, AGENTS[k].y);
+        assert_int(atomic_load(&mem->grid[AGENTS[k].x][AGENTS[k].y].occupant), ==, k);
+        assert_int(targets[k], ==, AGENTS[k].target);
+    }
+
+    cleanup_shared_mem(mem);
+    free(mem);
+    return MUNIT_OK;
+}
+
+static MunitResult test_scenario_invalid(const MunitParameter params[], void *data) {
+    // Corrupt the magic number
+    FILE *file = fopen(data, "r+b");
+    assert_not_null(file);
+    uint32_t magic = 0;
+    assert_int(fwrite(&magic, sizeof(magic), 1, file), ==, 1);
+    fclose(file);
+
+    scenario_t scenario;
+    int status = scenario_open(&scenario, data);
+    assert_int(status, !=, 0);
+    assert_int(errno, ==, EINVAL);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_scenario_cells(const MunitParameter params[], void *data) {
+    scenario_t scenario;
+    assert_int(scenario_open(&scenario, data), ==, 0);
+
+    scenario_cells_t list;
+    assert_int(scenario_read_cells(&scenario, &list), ==, 0);
+    assert_uint64(list.count, ==, BROKEN_COUNT);
+    for (uint64_t i = 0; i < BROKEN_COUNT; ++i)
+        assert_uint64(list.cells[i], ==, BROKEN[i]);
+    free(list.cells);
+    scenario_close(&scenario);
+
+    // A header claiming fewer or more cells than the payload holds is rejected without overflowing the list
+    const uint64_t counts[] = {1, BROKEN_COUNT + 1};
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i) {
+        FILE *file = fopen(data, "r+b");
+        assert_not_null(file);
+        assert_int(fseek(file, offsetof(scenario_header_t, broken_count), SEEK_SET), ==, 0);
+        assert_int(fwrite(&counts[i], sizeof(counts[i]), 1, file), ==, 1);
+        fclose(file);
+
+        assert_int(scenario_open(&scenario, data), ==, 0);
+        assert_int(scenario_read_cells(&scenario, &list), !=, 0);
+        assert_int(errno, ==, EINVAL);
+        assert_null(list.cells);
+        scenario_close(&scenario);
+    }
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_scenario_swapped(const MunitParameter params[], void *data) {
+    // A file written on a host of the other byte order
+    FILE *file = fopen(data, "r+b");
+    assert_not_null(file);
+    uint32_t magic = __builtin_bswap32(SCENARIO_MAGIC);
+    assert_int(fwrite(&magic, sizeof(magic), 1, file), ==, 1);
+    fclose(file);
+
+    scenario_t scenario;
+    assert_int(scenario_open(&scenario, data), !=, 0);
+    assert_int(errno, ==, EINVAL);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_scenario_targets(const MunitParameter params[], void *data) {
+    const uint32_t bad[] = {0, (uint32_t) SCENARIO_MAX_TARGET + 1, UINT32_MAX};
+
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        // Patch the target of the last agent record
+        FILE *file = fopen(data, "r+b");
+        assert_not_null(file);
+        long offset = sizeof(scenario_header_t) + (AGENT_COUNT - 1) * sizeof(scenario_agent_t) + offsetof(scenario_agent_t, target);
+        assert_int(fseek(file, offset, SEEK_SET), ==, 0);
+        assert_int(fwrite(&bad[i], sizeof(bad[i]), 1, file), ==, 1);
+        fclose(file);
+
+        scenario_t scenario;
+        assert_int(scenario_open(&scenario, data), !=, 0);
+        assert_int(errno, ==, EINVAL);
+
+        // Such agents can't be written either
+        scenario_agent_t agents[AGENT_COUNT];
+        memcpy(agents, AGENTS, sizeof(agents));
+        agents[AGENT_COUNT - 1].target = bad[i];
+        assert_int(scenario_write(data, GRID_SIZE, GRID_SIZE, SCENARIO_RLE, agents, AGENT_COUNT, BROKEN, BROKEN_COUNT), !=, 0);
+        assert_int(errno, ==, EINVAL);
+    }
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_scenario_unaligned(const MunitParameter params[], void *data) {
+    // An odd number of 12 byte agent records leaves the payload off its 8 byte alignment
+    int status = scenario_write(data, GRID_SIZE, GRID_SIZE, SCENARIO_BITMAP, AGENTS, AGENT_COUNT - 1, BROKEN, BROKEN_COUNT);
+    assert_int(status, ==, 0);
+
+    scenario_t scenario;
+    assert_int(scenario_open(&scenario, data), ==, 0);
+    assert_int((uintptr_t) scenario.payload % sizeof(uint64_t), !=, 0);
+
+    collect_t collect = {{0}, 0, 0};
+    assert_int(scenario_for_each_run(&scenario, collect_run, &collect), ==, 0);
+    assert_int(collect.count, ==, BROKEN_COUNT);
+    for (uint64_t i = 0; i < BROKEN_COUNT; ++i)
+        assert_int(collect.indices[i], ==, BROKEN[i]);
+
+    scenario_close(&scenario);
+    return MUNIT_OK;
+}
+
+static char* encoding_params[] = {"rle", "bitmap", NULL};
+
+static MunitParameterEnum scenario_params[] = {
+    {"encoding", encoding_params},
+    {NULL, NULL}
+};
+
+static MunitTest tests[] = {
+    {"/test_scenario_runs", test_scenario_runs, setup, teardown, MUNIT_TEST_OPTION_NONE, scenario_params},
+    {"/test_scenario_load", test_scenario_load, setup, teardown, MUNIT_TEST_OPTION_NONE, scenario_params},
+    {"/test_scenario_invalid", test_scenario_invalid, setup, teardown, MUNIT_TEST_OPTION_NONE, scenario_params},
+    {"/test_scenario_cells", test_scenario_cells, setup, teardown, MUNIT_TEST_OPTION_NONE, scenario_params},
+    {"/test_scenario_swapped", test_scenario_swapped, setup, teardown, MUNIT_TEST_OPTION_NONE, scenario_params},
+    {"/test_scenario_targets", test_scenario_targets, setup, teardown, MUNIT_TEST_OPTION_NONE, scenario_params},
+    {"/test_scenario_unaligned", test_scenario_unaligned, setup, teardown, MUNIT_TEST_OPTION_NONE, scenario_params},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static MunitSuite suite = {
+    "/scenario_tests",          // Test suite name
+    tests,                      // Tests in this suite
+    NULL,                       // No sub-suites
+    1,                          // Number of iterations
+    MUNIT_SUITE_OPTION_NONE     // Options
+};
+
+int main(int argc, char *argv[]) {
+    return munit_suite_main(&suite, NULL, argc, argv);
+}
@@ -0,0 +1,244 @@
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <semaphore.h>
+#include <pthread.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "munit/munit.h"
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "harness.h"
+#include "server.h"
+
+/** Socket path used by the tests, so a real server isn't disturbed */
+#define TEST_SOCKET_PATH "/tmp/repairmen-test.sock"
+
+/** Parameters of an unpaced run where nobody reaches their target, so every cell gets fixed */
+static const server_request_t FULL_RUN = {
+    .target = {HARNESS_NO_TARGET, HARNESS_NO_TARGET, HARNESS_NO_TARGET, HARNESS_NO_TARGET},
+    .seed = 0,
+    .mode = MODE_LOCKSTEP,
+    .max_staleness = 0,
+    .pacing_us = 0
+};
+
+static void* setup(const MunitParameter params[], void *data) {
+    server_t *server = malloc(sizeof(server_t));
+    assert_not_null(server);
+    assert_int(server_create(server, &FULL_RUN), ==, 0);
+    return server;
+}
+
+static void teardown(void *data) {
+    server_destroy(data);
+    free(data);
+}
+
+static MunitResult test_reset_shared_mem(const MunitParameter params[], void *data) {
+    shared_mem_t *mem = mmap(NULL, 2 * sizeof(shared_mem_t), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    assert_ptr_not_equal(mem, MAP_FAILED);
+    assert_int(initialize_shared_mem(&mem[0]), ==, 0);
+    assert_int(initialize_shared_mem(&mem[1]), ==, 0);
+
+    // The same seed gives the same grid, no matter what the grid looked like before
+    mem[0].result[0].fixes = 3;
+    atomic_store(&mem[0].running, 0);
+    assert_int(reset_shared_mem(&mem[0], 7), ==, 0);
+    assert_int(reset_shared_mem(&mem[1], 7), ==, 0);
+
+    int total_broken = 0;
+    for (int i = 0; i < GRID_SIZE; ++i) {
+        for (int j = 0; j < GRID_SIZE; ++j) {
+            assert_int(mem[0].grid[i][j].fixed, ==, mem[1].grid[i][j].fixed);
+            total_broken += !mem[0].grid[i][j].fixed;
+        }
+    }
+    assert_int(atomic_load(&mem[0].total_broken), ==, total_broken);
+    assert_int(mem[0].result[0].fixes, ==, 0);
+    assert_int(atomic_load(&mem[0].running), ==, AGENT_COUNT);
+
+    // Only the starting cells are occupied
+    for (int k = 0; k < AGENT_COUNT; ++k) {
+        cell_t *cell = &mem[0].grid[mem[0].start[k][0]][mem[0].start[k][1]];
+        assert_int(atomic_load(&cell->occupant), ==, k);
+    }
+    assert_int(atomic_load(&mem[0].grid[1][1].occupant), ==, CELL_EMPTY);
+
+    cleanup_shared_mem(&mem[0]);
+    cleanup_shared_mem(&mem[1]);
+    munmap(mem, 2 * sizeof(shared_mem_t));
+    return MUNIT_OK;
+}
+
+static MunitResult test_server_run(const MunitParameter params[], void *data) {
+    server_t *server = data;
+    server_request_t request = FULL_RUN;
+    server_reply_t first, reply;
+    if (strcmp(munit_parameters_get(params, "mode"), "relaxed") == 0) {
+        request.mode = MODE_RELAXED;
+        request.max_staleness = 2;
+    }
+
+    // More runs than slots, so every slot is reused
+    for (int run = 0; run < 2 * SERVER_POOL_SIZE + 1; ++run) {
+        request.seed = run % 2 == 0 ? 42 : 0;
+        assert_int(server_run(server, &request, &reply), ==, 0);
+        assert_uint(reply.seed, !=, 0);
+
+        int fixes = 0;
+        for (int k = 0; k < AGENT_COUNT; ++k)
+            fixes += reply.result[k].fixes;
+        assert_int(fixes, ==, reply.total_broken);
+
+        if (request.seed == 0)
+            continue;
+
+        // Lockstep runs with the same seed are identical
+        assert_uint(reply.seed, ==, 42);
+        if (run == 0) {
+            first = reply;
+        }
+        else {
+            assert_int(reply.total_broken, ==, first.total_broken);
+            if (request.mode == MODE_LOCKSTEP)
+                assert_memory_equal(sizeof(reply.result), reply.result, first.result);
+        }
+    }
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_server_worker_died(const MunitParameter params[], void *data) {
+    server_t *server = data;
+    server_request_t request = FULL_RUN;
+    server_reply_t reply;
+    if (strcmp(munit_parameters_get(params, "mode"), "relaxed") == 0) {
+        request.mode = MODE_RELAXED;
+        request.max_staleness = 2;
+    }
+
+    // The first free slot loses a worker, so its other agents would wait for it forever
+    pid_t victim = server->worker[0][1];
+    assert_int(kill(victim, SIGKILL), ==, 0);
+    assert_int(server_run(server, &request, &reply), !=, 0);
+    assert_int(errno, ==, EOWNERDEAD);
+
+    // The slot was replaced, so it serves runs again and the server shuts down
+    assert_not_null(server->slot[0]);
+    assert_int(server->worker[0][1], !=, victim);
+    for (int run = 0; run < SERVER_POOL_SIZE + 1; ++run)
+        assert_int(server_run(server, &request, &reply), ==, 0);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_server_respawn_failed(const MunitParameter params[], void *data) {
+    server_t *server = data;
+    server_reply_t reply;
+
+    // Every worker dies and nobody is left to fork new ones
+    for (int s = 0; s < SERVER_POOL_SIZE; ++s)
+        for (int k = 0; k < AGENT_COUNT; ++k)
+            assert_int(kill(server->worker[s][k], SIGKILL), ==, 0);
+    assert_int(kill(server->spawner, SIGKILL), ==, 0);
+    assert_int(waitpid(server->spawner, NULL, 0), ==, server->spawner);
+
+    // Each run fails and drops its slot, since it can't be replaced
+    for (int run = 0; run < SERVER_POOL_SIZE; ++run)
+        assert_int(server_run(server, &FULL_RUN, &reply), !=, 0);
+    for (int s = 0; s < SERVER_POOL_SIZE; ++s)
+        assert_null(server->slot[s]);
+
+    // Dropped slots are never picked again, runs fail right away and the server still shuts down
+    assert_int(server_run(server, &FULL_RUN, &reply), !=, 0);
+    assert_int(errno, ==, ECHILD);
+
+    return MUNIT_OK;
+}
+
+static void *serve_thread(void *data) {
+    return (void *) (intptr_t) server_serve(data);
+}
+
+static MunitResult test_server_socket(const MunitParameter params[], void *data) {
+    server_t *server = data;
+    char reply[SERVER_LINE_MAX];
+
+    assert_int(server_listen(server, TEST_SOCKET_PATH), ==, 0);
+    pthread_t thread;
+    assert_int(pthread_create(&thread, NULL, serve_thread, server), ==, 0);
+
+    assert_int(server_request(TEST_SOCKET_PATH, "RUN 50 50 50 50 seed=9 pacing=0 staleness=1", reply, sizeof(reply)), ==, 0);
+    assert_true(strncmp(reply, "OK seed=9 total_broken=", strlen("OK seed=9 total_broken=")) == 0);
+    assert_not_null(strstr(reply, " agent4="));
+
+    assert_int(server_request(TEST_SOCKET_PATH, "RUN 50 50 50", reply, sizeof(reply)), ==, 0);
+    assert_true(strncmp(reply, "ERR", strlen("ERR")) == 0);
+    assert_int(server_request(TEST_SOCKET_PATH, "RUN 50 50 50 50 speed=3", reply, sizeof(reply)), ==, 0);
+    assert_true(strncmp(reply, "ERR", strlen("ERR")) == 0);
+
+    // Values that don't fit their field are refused rather than wrapped around
+    const char *const out_of_range[] = {
+        "RUN 50 50 50 50 seed=4294967296",
+        "RUN 50 50 50 2147483648",
+        "RUN 50 50 50 50 pacing=2147483648",
+        "RUN 50 50 50 50 staleness=99999999999999999999",
+    };
+    for (size_t i = 0; i < sizeof(out_of_range) / sizeof(out_of_range[0]); ++i) {
+        assert_int(server_request(TEST_SOCKET_PATH, out_of_range[i], reply, sizeof(reply)), ==, 0);
+        assert_true(strncmp(reply, "ERR", strlen("ERR")) == 0);
+    }
+    assert_int(server_request(TEST_SOCKET_PATH, "RUN 50 50 50 50 seed=4294967295", reply, sizeof(reply)), ==, 0);
+    assert_true(strncmp(reply, "OK seed=4294967295 ", strlen("OK seed=4294967295 ")) == 0);
+
+    assert_int(server_request(TEST_SOCKET_PATH, "HELLO", reply, sizeof(reply)), ==, 0);
+    assert_true(strncmp(reply, "ERR", strlen("ERR")) == 0);
+
+    assert_int(server_request(TEST_SOCKET_PATH, "QUIT", reply, sizeof(reply)), ==, 0);
+    assert_string_equal(reply, "OK");
+
+    void *status;
+    pthread_join(thread, &status);
+    assert_int((intptr_t) status, ==, 0);
+
+    return MUNIT_OK;
+}
+
+static char* mode_params[] = {"lockstep", "relaxed", NULL};
+
+static MunitParameterEnum run_params[] = {
+    {"mode", mode_params},
+    {NULL, NULL}
+};
+
+static MunitTest tests[] = {
+    {"/test_reset_shared_mem", test_reset_shared_mem, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_server_run", test_server_run, setup, teardown, MUNIT_TEST_OPTION_NONE, run_params},
+    {"/test_server_worker_died", test_server_worker_died, setup, teardown, MUNIT_TEST_OPTION_NONE, run_params},
+    {"/test_server_respawn_failed", test_server_respawn_failed, setup, teardown, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_server_socket", test_server_socket, setup, teardown, MUNIT_TEST_OPTION_NONE, NULL},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static MunitSuite suite = {
+    "/server_tests",            // Test suite name
+    tests,                      // Tests in this suite
+    NULL,                       // No sub-suites
+    1,                          // Number of iterations
+    MUNIT_SUITE_OPTION_NONE     // Options
+};
+
+int main(int argc, char *argv[]) {
+    return munit_suite_main(&suite, NULL, argc, argv);
+}
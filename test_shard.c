@@ -0,0 +1,187 @@
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <semaphore.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "munit/munit.h"
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "shard.h"
+
+static MunitResult test_shard_rows(const MunitParameter params[], void *data) {
+    int n_shards = strtol(munit_parameters_get(params, "shards"), NULL, 0);
+
+    // Shards cover every row exactly once, in order
+    int next = 0;
+    for (int s = 0; s < n_shards; ++s) {
+        int first = 0, count = 0;
+        shard_rows(s, n_shards, &first, &count);
+
+        assert_int(first, ==, next);
+        assert_int(count, >=, GRID_SIZE / n_shards);
+        assert_int(count, <=, GRID_SIZE / n_shards + 1);
+        next = first + count;
+    }
+    assert_int(next, ==, GRID_SIZE);
+
+    return MUNIT_OK;
+}
+
+// Targets no agent can reach, so the run only ends once the whole grid is fixed
+static const int UNREACHABLE[AGENT_COUNT] = {
+    GRID_SIZE * GRID_SIZE + 1, GRID_SIZE * GRID_SIZE + 1, GRID_SIZE * GRID_SIZE + 1, GRID_SIZE * GRID_SIZE + 1
+};
+
+// Every broken cell got fixed by exactly one agent, wherever it crossed shard borders
+static void assert_report(const shard_report_t *report) {
+    int fixes = 0;
+    for (int i = 0; i < AGENT_COUNT; ++i) {
+        assert_int(report->result[i].steps, >, 0);
+        fixes += report->result[i].fixes;
+    }
+    assert_int(fixes, ==, report->total_broken);
+}
+
+static MunitResult test_run_distributed(const MunitParameter params[], void *data) {
+    int n_shards = strtol(munit_parameters_get(params, "shards"), NULL, 0);
+
+    shard_report_t report;
+    assert_int(run_distributed(n_shards, UNREACHABLE, &report), ==, 0);
+    assert_report(&report);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_run_remote(const MunitParameter params[], void *data) {
+    const int n_shards = 3;
+    char address[64] = "/tmp/repairmen-shard-test.sock";
+
+    bool tcp = strcmp(munit_parameters_get(params, "transport"), "tcp") == 0;
+    int listen_fd = shard_listen(tcp ? "127.0.0.1:0" : address);
+    assert_int(listen_fd, !=, -1);
+
+    // Let the kernel pick a free port and tell the shards where it is
+    if (tcp) {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        assert_int(getsockname(listen_fd, (struct sockaddr *) &addr, &len), ==, 0);
+        snprintf(address, sizeof(address), "127.0.0.1:%d", ntohs(addr.sin_port));
+    }
+
+    fflush(stdout);
+    for (int s = 0; s < n_shards; ++s) {
+        if (fork() == 0) {
+            close(listen_fd);
+            exit(run_shard(address) == 0 ? 0 : 1);
+        }
+    }
+
+    shard_report_t report;
+    assert_int(run_coordinator(listen_fd, n_shards, UNREACHABLE, &report), ==, 0);
+    close(listen_fd);
+    assert_report(&report);
+
+    for (int s = 0; s < n_shards; ++s) {
+        int wstatus = 0;
+        wait(&wstatus);
+        assert_true(WIFEXITED(wstatus));
+        assert_int(WEXITSTATUS(wstatus), ==, 0);
+    }
+
+    if (!tcp)
+        unlink(address);
+    return MUNIT_OK;
+}
+
+static MunitResult test_shard_killed(const MunitParameter params[], void *data) {
+    const int n_shards = 3, victim = 1;
+    int shard_fds[n_shards];
+    pid_t pids[n_shards];
+
+    fflush(stdout);
+    for (int s = 0; s < n_shards; ++s) {
+        int pair[2];
+        assert_int(socketpair(AF_UNIX, SOCK_STREAM, 0, pair), ==, 0);
+
+        pids[s] = fork();
+        assert_int(pids[s], !=, -1);
+        if (pids[s] == 0) {
+            for (int t = 0; t < s; ++t)
+                close(shard_fds[t]);
+            close(pair[0]);
+            if (s == victim)
+                raise(SIGKILL);
+            exit(shard_main(pair[1]) == 0 ? 0 : 1);
+        }
+
+        close(pair[1]);
+        shard_fds[s] = pair[0];
+    }
+
+    // The coordinator notices instead of waiting forever, and the other shards see it go away
+    alarm(10);
+    shard_report_t report;
+    assert_int(coordinator_main(n_shards, shard_fds, UNREACHABLE, &report), !=, 0);
+    alarm(0);
+
+    for (int s = 0; s < n_shards; ++s)
+        close(shard_fds[s]);
+
+    for (int s = 0; s < n_shards; ++s) {
+        int wstatus = 0;
+        assert_int(waitpid(pids[s], &wstatus, 0), ==, pids[s]);
+        if (s == victim) {
+            assert_true(WIFSIGNALED(wstatus));
+        }
+        else {
+            assert_true(WIFEXITED(wstatus));
+            assert_int(WEXITSTATUS(wstatus), ==, 1);
+        }
+    }
+
+    return MUNIT_OK;
+}
+
+static char* shard_params[] = {"1", "2", "3", "7", NULL};
+
+static MunitParameterEnum shards_params[] = {
+    {"shards", shard_params},
+    {NULL, NULL}
+};
+
+static char* transport_params[] = {"unix", "tcp", NULL};
+
+static MunitParameterEnum remote_params[] = {
+    {"transport", transport_params},
+    {NULL, NULL}
+};
+
+static MunitTest tests[] = {
+    {"/test_shard_rows", test_shard_rows, NULL, NULL, MUNIT_TEST_OPTION_NONE, shards_params},
+    {"/test_run_distributed", test_run_distributed, NULL, NULL, MUNIT_TEST_OPTION_NONE, shards_params},
+    {"/test_run_remote", test_run_remote, NULL, NULL, MUNIT_TEST_OPTION_NONE, remote_params},
+    {"/test_shard_killed", test_shard_killed, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static MunitSuite suite = {
+    "/shard_tests",             // Test suite name
+    tests,                      // Tests in this suite
+    NULL,                       // No sub-suites
+    1,                          // Number of iterations
+    MUNIT_SUITE_OPTION_NONE     // Options
+};
+
+int main(int argc, char *argv[]) {
+    return munit_suite_main(&suite, NULL, argc, argv);
+}
@@ -0,0 +1,281 @@
+#include <unistd.h>
+#include <sys/wait.h>
+#include <semaphore.h>
+#include <pthread.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "munit/munit.h"
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "harness.h"
+#include "scenario.h"
+#include "sparse.h"
+
+/** Side of the grid used by the tests, far larger than a dense grid could hold */
+#define HUGE_SIZE 1000000
+
+#define NUM_WORKERS 8
+#define NUM_KEYS 512
+
+static void* setup(const MunitParameter params[], void *data) {
+    sparse_grid_t *grid = sparse_create(HUGE_SIZE, HUGE_SIZE, 4 * NUM_KEYS);
+    assert_not_null(grid);
+    return grid;
+}
+
+static void teardown(void *data) {
+    sparse_destroy(data);
+}
+
+static MunitResult test_sparse_get_find(const MunitParameter params[], void *data) {
+    sparse_grid_t *grid = data;
+    int pos[2] = {HUGE_SIZE - 1, 12345};
+
+    // Cells that were never stored count as fixed with an empty log
+    assert_null(sparse_find(grid, pos));
+
+    cell_t *cell = sparse_get(grid, pos);
+    assert_not_null(cell);
+    assert_true(atomic_load(&cell->fixed));
+    assert_int(atomic_load(&cell->occupant), ==, CELL_EMPTY);
+    assert_int(atomic_load(&grid->used), ==, 1);
+
+    assert_ptr_equal(sparse_get(grid, pos), cell);
+    assert_ptr_equal(sparse_find(grid, pos), cell);
+    assert_int(atomic_load(&grid->used), ==, 1);
+
+    // The transposed position is a different cell
+    int other[2] = {12345, HUGE_SIZE - 1};
+    assert_null(sparse_find(grid, other));
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_sparse_full(const MunitParameter params[], void *data) {
+    sparse_grid_t *grid = sparse_create(HUGE_SIZE, HUGE_SIZE, 4);
+    assert_not_null(grid);
+
+    for (int i = 0; i < 4; ++i) {
+        int pos[2] = {i, i};
+        assert_not_null(sparse_get(grid, pos));
+    }
+
+    int pos[2] = {4, 4};
+    assert_null(sparse_get(grid, pos));
+    assert_int(errno, ==, ENOSPC);
+
+    sparse_destroy(grid);
+    return MUNIT_OK;
+}
+
+// Insert the same keys from every worker, in a different order each
+static void insert_worker(sparse_grid_t *grid, int id) {
+    for (int i = 0; i < NUM_KEYS; ++i) {
+        int k = (i * 7 + id * NUM_KEYS / NUM_WORKERS) % NUM_KEYS;
+        int pos[2] = {k * 1000, k};
+        cell_t *cell = sparse_get(grid, pos);
+        if (cell)
+            atomic_fetch_add(&cell->log[0], 1);
+    }
+}
+
+typedef struct {
+    sparse_grid_t *grid;
+    int id;
+} worker_args_t;
+
+static void* worker_thread(void *data) {
+    worker_args_t *args = data;
+    insert_worker(args->grid, args->id);
+    return NULL;
+}
+
+static MunitResult test_sparse_concurrent(const MunitParameter params[], void *data) {
+    sparse_grid_t *grid = data;
+
+    if (strcmp(munit_parameters_get(params, "model"), "thread") == 0) {
+        pthread_t threads[NUM_WORKERS];
+        worker_args_t args[NUM_WORKERS];
+        for (int i = 0; i < NUM_WORKERS; ++i) {
+            args[i] = (worker_args_t) {grid, i};
+            assert_int(pthread_create(&threads[i], NULL, worker_thread, &args[i]), ==, 0);
+        }
+        for (int i = 0; i < NUM_WORKERS; ++i)
+            pthread_join(threads[i], NULL);
+    }
+    else {
+        for (int i = 0; i < NUM_WORKERS; ++i) {
+            pid_t pid = fork();
+            assert_int(pid, !=, -1);
+            if (pid == 0) {
+                insert_worker(grid, i);
+                _exit(0);
+            }
+        }
+        for (int i = 0; i < NUM_WORKERS; ++i)
+            wait(NULL);
+    }
+
+    // Each key got exactly one slot, and every worker reached it
+    assert_int(atomic_load(&grid->used), ==, NUM_KEYS);
+    for (int k = 0; k < NUM_KEYS; ++k) {
+        int pos[2] = {k * 1000, k};
+        cell_t *cell = sparse_find(grid, pos);
+        assert_not_null(cell);
+        assert_int(atomic_load(&cell->log[0]), ==, NUM_WORKERS);
+    }
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_sparse_scenario(const MunitParameter params[], void *data) {
+    sparse_grid_t *grid = data;
+
+    char path[] = "/tmp/test_sparse_XXXXXX";
+    int fd = mkstemp(path);
+    assert_int(fd, !=, -1);
+    close(fd);
+
+    const uint64_t broken[] = {5, 6, 7, (uint64_t) HUGE_SIZE * 500000 + 42, (uint64_t) HUGE_SIZE * HUGE_SIZE - 1};
+    const scenario_agent_t agents[AGENT_COUNT] = {
+        {0, 0, 10},
+        {0, HUGE_SIZE - 1, 10},
+        {HUGE_SIZE - 1, 0, 10},
+        {HUGE_SIZE - 1, HUGE_SIZE - 1, 10}
+    };
+    int status = scenario_write(path, HUGE_SIZE, HUGE_SIZE, SCENARIO_RLE, agents, AGENT_COUNT, broken, 5);
+    assert_int(status, ==, 0);
+
+    shared_mem_t *mem = malloc(sizeof(shared_mem_t));
+    if (!mem)
+        return MUNIT_ERROR;
+    assert_int(initialize_shared_mem(mem), ==, 0);
+
+    scenario_t scenario;
+    int targets[AGENT_COUNT];
+    assert_int(scenario_open(&scenario, path), ==, 0);
+    assert_int(scenario_load_sparse(mem, grid, &scenario, targets), ==, 0);
+    scenario_close(&scenario);
+    unlink(path);
+
+    assert_ptr_equal(mem->sparse, grid);
+    assert_int(mem->bounds[0], ==, HUGE_SIZE);
+    assert_int(mem->total_broken, ==, 5);
+
+    // Only broken cells and the cell under each agent take up memory
+    assert_int(atomic_load(&grid->used), ==, 5 + AGENT_COUNT - 1);
+
+    int far[2] = {500000, 42};
+    assert_false(atomic_load(&grid_cell(mem, far)->fixed));
+    int corner[2] = {HUGE_SIZE - 1, HUGE_SIZE - 1};
+    assert_false(atomic_load(&grid_cell(mem, corner)->fixed));
+    assert_int(atomic_load(&grid_cell(mem, corner)->occupant), ==, 3);
+
+    cleanup_shared_mem(mem);
+    free(mem);
+    return MUNIT_OK;
+}
+
+/** Side of the grid agents run on, small enough for a random walk to find every broken cell */
+#define RUN_SIZE 8
+
+static MunitResult test_sparse_agents(const MunitParameter params[], void *data) {
+    char path[] = "/tmp/test_sparse_XXXXXX";
+    int fd = mkstemp(path);
+    assert_int(fd, !=, -1);
+    close(fd);
+
+    const uint64_t broken[] = {9, 20, 35, 54};
+    const scenario_agent_t agents[AGENT_COUNT] = {
+        {0, 0, RUN_SIZE * RUN_SIZE},
+        {0, RUN_SIZE - 1, RUN_SIZE * RUN_SIZE},
+        {RUN_SIZE - 1, 0, RUN_SIZE * RUN_SIZE},
+        {RUN_SIZE - 1, RUN_SIZE - 1, RUN_SIZE * RUN_SIZE}
+    };
+    int status = scenario_write(path, RUN_SIZE, RUN_SIZE, SCENARIO_RLE, agents, AGENT_COUNT, broken, 4);
+    assert_int(status, ==, 0);
+
+    // A full table only holds the broken cells and the starting cells, so the first move has nowhere to go
+    bool full = strcmp(munit_parameters_get(params, "capacity"), "full") == 0;
+    sparse_grid_t *grid = sparse_create(RUN_SIZE, RUN_SIZE, full ? 4 + AGENT_COUNT : RUN_SIZE * RUN_SIZE);
+    assert_not_null(grid);
+
+    shared_mem_t *mem = harness_map();
+    assert_not_null(mem);
+    if (strcmp(munit_parameters_get(params, "mode"), "relaxed") == 0) {
+        mem->mode = MODE_RELAXED;
+        mem->max_staleness = 1;
+    }
+
+    scenario_t scenario;
+    int targets[AGENT_COUNT];
+    assert_int(scenario_open(&scenario, path), ==, 0);
+    assert_int(scenario_load_sparse(mem, grid, &scenario, targets), ==, 0);
+    scenario_close(&scenario);
+    unlink(path);
+
+    // Every agent of the scenario has the same target
+    assert_int(harness_run(mem, targets[0]), ==, 0);
+
+    // Every agent exits, either with every cell fixed or once it can't track where it's going
+    assert_int(atomic_load(&mem->running), ==, 0);
+    if (full) {
+        assert_int(atomic_load(&grid->used), ==, grid->capacity);
+    }
+    else {
+        for (int i = 0; i < 4; ++i) {
+            int pos[2] = {broken[i] / RUN_SIZE, broken[i] % RUN_SIZE};
+            assert_true(atomic_load(&sparse_find(grid, pos)->fixed));
+        }
+    }
+
+    harness_unmap(mem);
+    sparse_destroy(grid);
+    return MUNIT_OK;
+}
+
+static char* model_params[] = {"thread", "process", NULL};
+
+static MunitParameterEnum concurrent_params[] = {
+    {"model", model_params},
+    {NULL, NULL}
+};
+
+static char* mode_params[] = {"lockstep", "relaxed", NULL};
+
+static char* capacity_params[] = {"roomy", "full", NULL};
+
+static MunitParameterEnum agents_params[] = {
+    {"mode", mode_params},
+    {"capacity", capacity_params},
+    {NULL, NULL}
+};
+
+static MunitTest tests[] = {
+    {"/test_sparse_get_find", test_sparse_get_find, setup, teardown, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_sparse_full", test_sparse_full, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_sparse_concurrent", test_sparse_concurrent, setup, teardown, MUNIT_TEST_OPTION_NONE, concurrent_params},
+    {"/test_sparse_scenario", test_sparse_scenario, setup, teardown, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_sparse_agents", test_sparse_agents, NULL, NULL, MUNIT_TEST_OPTION_NONE, agents_params},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static MunitSuite suite = {
+    "/sparse_tests",            // Test suite name
+    tests,                      // Tests in this suite
+    NULL,                       // No sub-suites
+    1,                          // Number of iterations
+    MUNIT_SUITE_OPTION_NONE     // Options
+};
+
+int main(int argc, char *argv[]) {
+    return munit_suite_main(&suite, NULL, argc, argv);
+}
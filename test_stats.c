@@ -0,0 +1,126 @@
+#include <unistd.h>
+#include <sys/mman.h>
+#include <semaphore.h>
+#include <pthread.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define MUNIT_ENABLE_ASSERT_ALIASES
+#include "munit/munit.h"
+
+#include "barrier.h"
+#include "repairmen.h"
+#include "harness.h"
+#include "stats.h"
+
+/** Segment name used by the tests, so a real run isn't disturbed */
+#define TEST_STATS_NAME "/repairmen-stats-test"
+
+static MunitResult test_stats_attach(const MunitParameter params[], void *data) {
+    shm_unlink(TEST_STATS_NAME);
+    assert_null(stats_attach(TEST_STATS_NAME));
+    assert_int(errno, ==, ENOENT);
+
+    stats_t *stats = stats_create(TEST_STATS_NAME, 10);
+    assert_not_null(stats);
+
+    const stats_t *view = stats_attach(TEST_STATS_NAME);
+    assert_not_null(view);
+    assert_ptr_not_equal(view, stats);
+    assert_int(atomic_load(&view->remaining), ==, 10);
+    assert_int(atomic_load(&view->running), ==, AGENT_COUNT);
+
+    // Updates show through the read-only mapping
+    stats_record_step(stats, 1, 5, 3, 2);
+    stats_record_fix(stats);
+    stats_record_fix(stats);
+    stats_record_wait(stats, 1, 1000);
+    stats_record_wait(stats, 1, 500);
+    assert_int(atomic_load(&view->agent[1].step), ==, 5);
+    assert_int(atomic_load(&view->agent[1].moves), ==, 3);
+    assert_int(atomic_load(&view->agent[1].fixes), ==, 2);
+    assert_uint64(atomic_load(&view->agent[1].wait_ns), ==, 1500);
+    assert_int(atomic_load(&view->remaining), ==, 8);
+
+    for (int i = 0; i < AGENT_COUNT; ++i) {
+        assert_false(atomic_load(&view->done));
+        stats_record_exit(stats, i);
+        assert_true(atomic_load(&view->agent[i].exited));
+    }
+    assert_true(atomic_load(&view->done));
+
+    // Recording without a segment does nothing
+    stats_record_step(NULL, 0, 1, 1, 1);
+    stats_record_fix(NULL);
+    stats_record_exit(NULL, 0);
+
+    stats_detach(view);
+    stats_destroy(stats, TEST_STATS_NAME);
+    assert_null(stats_attach(TEST_STATS_NAME));
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_stats_run(const MunitParameter params[], void *data) {
+    shared_mem_t *mem = harness_map();
+    assert_not_null(mem);
+    if (strcmp(munit_parameters_get(params, "mode"), "relaxed") == 0) {
+        mem->mode = MODE_RELAXED;
+        mem->max_staleness = 1;
+    }
+
+    mem->stats = stats_create(TEST_STATS_NAME, mem->total_broken);
+    assert_not_null(mem->stats);
+
+    assert_int(harness_run(mem, HARNESS_NO_TARGET), ==, 0);
+
+    // Nobody reaches their target, so the run only ends once every cell is fixed
+    const stats_t *view = stats_attach(TEST_STATS_NAME);
+    assert_not_null(view);
+    assert_true(atomic_load(&view->done));
+    assert_int(atomic_load(&view->remaining), ==, 0);
+
+    int fixes = 0;
+    for (int i = 0; i < AGENT_COUNT; ++i) {
+        assert_int(atomic_load(&view->agent[i].step), ==, mem->result[i].steps);
+        assert_int(atomic_load(&view->agent[i].moves), ==, mem->result[i].moves);
+        assert_int(atomic_load(&view->agent[i].fixes), ==, mem->result[i].fixes);
+        fixes += atomic_load(&view->agent[i].fixes);
+    }
+    assert_int(fixes, ==, mem->total_broken);
+
+    stats_detach(view);
+    stats_destroy(mem->stats, TEST_STATS_NAME);
+    harness_unmap(mem);
+    return MUNIT_OK;
+}
+
+static char* mode_params[] = {"lockstep", "relaxed", NULL};
+
+static MunitParameterEnum run_params[] = {
+    {"mode", mode_params},
+    {NULL, NULL}
+};
+
+static MunitTest tests[] = {
+    {"/test_stats_attach", test_stats_attach, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL},
+    {"/test_stats_run", test_stats_run, NULL, NULL, MUNIT_TEST_OPTION_NONE, run_params},
+    {NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL}
+};
+
+static MunitSuite suite = {
+    "/stats_tests",             // Test suite name
+    tests,                      // Tests in this suite
+    NULL,                       // No sub-suites
+    1,                          // Number of iterations
+    MUNIT_SUITE_OPTION_NONE     // Options
+};
+
+int main(int argc, char *argv[]) {
+    return munit_suite_main(&suite, NULL, argc, argv);
+}